@@ -0,0 +1,446 @@
+// Headless benchmarks for the parser, the evaluators and the solvers.
+// Prints one JSON document to stdout so runs can be diffed or graphed:
+//
+//   ./secant_bench                      # default: ~100 ms per measurement
+//   ./secant_bench --min-time-ms 20     # quicker, noisier
+//   ./secant_bench --filter trig        # only cases whose name contains "trig"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "libs/Tokenizer.hpp"
+#include "libs/CompiledExpression.hpp"
+#include "libs/ExprGraph.hpp"
+#include "libs/Jit.hpp"
+#include "libs/Horner.hpp"
+#include "libs/AberthSolver.hpp"
+#include "libs/Solvers.hpp"
+#include "libs/TraceFile.hpp"
+
+// Exposes the private parser stages to the benchmark (see Tokenizer.hpp).
+struct ParserStages {
+    typedef std::vector<MathParser::Token> Tokens;
+
+    static const Tokens& tokenize(MathParser& p, const std::string& expr) { return p.tokenize(expr); }
+    static const Tokens& toRPN(MathParser& p, const Tokens& tokens) { return p.toRPN(tokens); }
+    static const CompiledExpression& lower(MathParser& p, const Tokens& rpn) { return p.lower(rpn); }
+};
+
+namespace {
+
+struct Case {
+    const char* name;
+    const char* expr;
+    double x1, x2; // secant starting points (both inside the basin of a root)
+};
+
+const Case kCorpus[] = {
+    {"poly_quadratic",   "x^2 - 4x - 10",                             5.0, 6.0},
+    {"poly_quintic",     "3x^5 - 2x^4 + x^3 - 7x^2 + 4x - 1",         1.2, 1.4},
+    {"poly_nested",      "((((2x + 3)x - 1)x + 5)x - 4)x + 2",        -2.0, -1.0},
+    {"trig_mix",         "sin(x)cos(x) + tan(x/4) - 0.3",             0.0, 0.5},
+    {"trig_exp_log",     "sin(x)^2 + cos(2x) - exp(x) + log(x+2)",    0.0, 1.0},
+    {"trig_shared",      "sin(x)*sin(x) + sin(x) - 0.5",              0.0, 1.0},
+    {"deep_nesting",     "((((((x+1)*(x-1))+2)*3)-4)/5)^2 - 1",       0.0, 1.0},
+    {"deep_functions",   "exp(sin(cos(exp(log(x^2+1)))))-1.5",        0.0, 1.0},
+    {"implicit_mult",    "2x(x+1)(x-3) - 4sin(x)x",                   3.0, 4.0},
+    {"implicit_consts",  "3x^2(2x - 1) - 2(x+1)(x-1)",                0.5, 1.0}
+};
+
+volatile double g_sink; // keeps measured results alive
+
+// Runs body(reps) with growing rep counts until one run takes at least
+// minTime, then keeps the fastest of five runs. Returns nanoseconds per rep.
+double measure(const std::function<double(long)>& body, double minTimeMs) {
+    typedef std::chrono::steady_clock Clock;
+
+    long reps = 1;
+    double best = 0.0;
+    for (;;) {
+        Clock::time_point t0 = Clock::now();
+        g_sink = body(reps);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        if (ms >= minTimeMs || reps > (1L << 40)) { best = ms * 1e6 / reps; break; }
+        reps = ms > 0.0 ? (long)(reps * std::min(100.0, 1.2 * minTimeMs / ms)) + 1 : reps * 100;
+    }
+
+    for (int run = 0; run < 4; ++run) {
+        Clock::time_point t0 = Clock::now();
+        g_sink = body(reps);
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / reps;
+        if (ns < best) best = ns;
+    }
+    return best;
+}
+
+std::string jsonEscape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+class Report {
+public:
+    // unit names what one op is ("call", "eval", "solve"); evalsPerOp is
+    // the number of f(x) evaluations behind one op, 0 when not applicable.
+    void add(const std::string& name, const std::string& stage, const std::string& unit,
+             double nsPerOp, double evalsPerOp = 0.0) {
+        char buf[512];
+        std::snprintf(buf, sizeof buf,
+            "    {\"case\": \"%s\", \"stage\": \"%s\", \"unit\": \"%s\", "
+            "\"ns_per_op\": %.3f, \"ops_per_sec\": %.1f",
+            jsonEscape(name).c_str(), stage.c_str(), unit.c_str(), nsPerOp, 1e9 / nsPerOp);
+        std::string row = buf;
+        if (evalsPerOp > 0.0) {
+            std::snprintf(buf, sizeof buf, ", \"evals_per_op\": %.2f, \"ns_per_eval\": %.3f",
+                          evalsPerOp, nsPerOp / evalsPerOp);
+            row += buf;
+        }
+        rows.push_back(row + "}");
+    }
+
+    void print(std::ostream& os, double minTimeMs) const {
+        os << "{\n  \"benchmark\": \"secant_bench\",\n";
+        os << "  \"compiler\": \"" << jsonEscape(__VERSION__) << "\",\n";
+        os << "  \"min_time_ms\": " << minTimeMs << ",\n";
+        os << "  \"results\": [\n";
+        for (size_t i = 0; i < rows.size(); ++i)
+            os << rows[i] << (i + 1 < rows.size() ? ",\n" : "\n");
+        os << "  ]\n}\n";
+    }
+
+private:
+    std::vector<std::string> rows;
+};
+
+const size_t kPoints = 1024; // evaluation sweep per rep
+
+void benchCase(const Case& c, double minTimeMs, Report& report) {
+    // The parse and interpreter stages are timed without native code; the
+    // JIT has stages of its own below
+    MathParser parser;
+    parser.setJit(false);
+    std::string expr = c.expr;
+
+    // Copies: the parser reuses its own buffers on every call
+    ParserStages::Tokens tokens = ParserStages::tokenize(parser, expr);
+    ParserStages::Tokens rpn = ParserStages::toRPN(parser, tokens);
+    CompiledExpression f = parser.compile(expr);
+
+    // The evaluator stages below time the program itself, so they keep
+    // covering the interpreter where f is a polynomial and compile() hands
+    // it to Horner's rule; that gets a stage of its own
+    parser.setPolynomials(false);
+    CompiledExpression program = parser.compile(expr);
+    parser.setPolynomials(true);
+
+    report.add(c.name, "tokenize", "call", measure([&](long reps) {
+        double acc = 0.0;
+        for (long r = 0; r < reps; ++r)
+            acc += (double)ParserStages::tokenize(parser, expr).size();
+        return acc;
+    }, minTimeMs));
+
+    report.add(c.name, "toRPN", "call", measure([&](long reps) {
+        double acc = 0.0;
+        for (long r = 0; r < reps; ++r)
+            acc += (double)ParserStages::toRPN(parser, tokens).size();
+        return acc;
+    }, minTimeMs));
+
+    report.add(c.name, "lower", "call", measure([&](long reps) {
+        double acc = 0.0;
+        for (long r = 0; r < reps; ++r)
+            acc += (double)ParserStages::lower(parser, rpn).program().size();
+        return acc;
+    }, minTimeMs));
+
+    report.add(c.name, "compile", "call", measure([&](long reps) {
+        double acc = 0.0;
+        for (long r = 0; r < reps; ++r)
+            acc += (double)parser.compile(expr).program().size();
+        return acc;
+    }, minTimeMs));
+
+    std::vector<double> xs(kPoints), out(kPoints);
+    for (size_t i = 0; i < kPoints; ++i)
+        xs[i] = 0.1 + 3.0 * (double)i / kPoints;
+
+    // The stack-machine interpreter, which replaced the old evalRPN.
+    report.add(c.name, "evalRPN", "eval", measure([&](long reps) {
+        double acc = 0.0;
+        for (long r = 0; r < reps; ++r)
+            for (size_t i = 0; i < kPoints; ++i)
+                acc += program(xs[i]);
+        return acc;
+    }, minTimeMs) / kPoints);
+
+    if (f.isPolynomial()) {
+        report.add(c.name, "eval_horner", "eval", measure([&](long reps) {
+            double acc = 0.0;
+            for (long r = 0; r < reps; ++r)
+                for (size_t i = 0; i < kPoints; ++i)
+                    acc += f(xs[i]);
+            return acc;
+        }, minTimeMs) / kPoints);
+    }
+
+    std::shared_ptr<const JitCode> native = JitCode::compile(program);
+    if (native) {
+        report.add(c.name, "jit_compile", "call", measure([&](long reps) {
+            double acc = 0.0;
+            for (long r = 0; r < reps; ++r)
+                acc += (double)JitCode::compile(program)->codeSize();
+            return acc;
+        }, minTimeMs));
+
+        JitCode::Function fn = native->function();
+        report.add(c.name, "eval_jit", "eval", measure([&](long reps) {
+            double acc = 0.0;
+            for (long r = 0; r < reps; ++r)
+                for (size_t i = 0; i < kPoints; ++i)
+                    acc += fn(xs[i], nullptr);
+            return acc;
+        }, minTimeMs) / kPoints);
+    }
+
+    report.add(c.name, "eval_batch", "eval", measure([&](long reps) {
+        double acc = 0.0;
+        for (long r = 0; r < reps; ++r) {
+            program.evaluate(xs.data(), out.data(), kPoints);
+            acc += out[r % kPoints];
+        }
+        return acc;
+    }, minTimeMs) / kPoints);
+
+    // Enclosures over narrow intervals, as root isolation evaluates them
+    report.add(c.name, "eval_interval", "eval", measure([&](long reps) {
+        double acc = 0.0;
+        for (long r = 0; r < reps; ++r)
+            for (size_t i = 0; i + 1 < kPoints; ++i)
+                acc += program.evaluate(Interval(xs[i], xs[i + 1])).hi;
+        return acc;
+    }, minTimeMs) / (kPoints - 1));
+
+    report.add(c.name, "eval_dual", "eval", measure([&](long reps) {
+        double acc = 0.0, d;
+        for (long r = 0; r < reps; ++r)
+            for (size_t i = 0; i < kPoints; ++i)
+                acc += program.evaluate(xs[i], d) + d;
+        return acc;
+    }, minTimeMs) / kPoints);
+
+    // Parses and evaluates in one call, as code that skips compile() would.
+    report.add(c.name, "MathParser::evaluate", "call", measure([&](long reps) {
+        double acc = 0.0;
+        for (long r = 0; r < reps; ++r)
+            acc += parser.evaluate(expr, xs[r % kPoints]);
+        return acc;
+    }, minTimeMs));
+
+    int evals = 0;
+    double nsPerSolve = measure([&](long reps) {
+        double acc = 0.0;
+        for (long r = 0; r < reps; ++r) {
+            RootSolver solver(f, RootSolver::SECANT, c.x1, c.x2);
+            solver.solve();
+            acc += solver.root();
+            evals = solver.evaluations();
+        }
+        return acc;
+    }, minTimeMs);
+    report.add(c.name, "secant_solve", "solve", nsPerSolve, evals);
+
+    // The same starting points through Brent's method
+    nsPerSolve = measure([&](long reps) {
+        double acc = 0.0;
+        for (long r = 0; r < reps; ++r) {
+            RootSolver solver(f, RootSolver::BRENT, c.x1, c.x2);
+            solver.solve();
+            acc += solver.root();
+            evals = solver.evaluations();
+        }
+        return acc;
+    }, minTimeMs);
+    report.add(c.name, "brent_solve", "solve", nsPerSolve, evals);
+}
+
+void benchHorner(double minTimeMs, Report& report) {
+    const int degrees[] = {4, 8, 16, 32, 64};
+    std::vector<double> xs(kPoints), out(kPoints);
+    for (size_t i = 0; i < kPoints; ++i)
+        xs[i] = -1.0 + 2.0 * (double)i / kPoints;
+
+    AberthSolver solver;
+
+    for (int n : degrees) {
+        std::string name = "horner_deg" + std::to_string(n);
+        std::vector<double> a(n + 1);
+        for (int i = 0; i <= n; ++i)
+            a[i] = 1.0 / (1.0 + i);
+
+        report.add(name, "horner", "eval", measure([&](long reps) {
+            double acc = 0.0;
+            for (long r = 0; r < reps; ++r)
+                for (size_t i = 0; i < kPoints; ++i)
+                    acc += horner(a.data(), n, xs[i]);
+            return acc;
+        }, minTimeMs) / kPoints);
+
+        report.add(name, "estrin", "eval", measure([&](long reps) {
+            double acc = 0.0;
+            for (long r = 0; r < reps; ++r)
+                for (size_t i = 0; i < kPoints; ++i)
+                    acc += estrin(a.data(), n, xs[i]);
+            return acc;
+        }, minTimeMs) / kPoints);
+
+        // Each x depends on the previous result, so this measures latency,
+        // which is where Estrin's shorter dependency chain shows
+        report.add(name, "horner_chained", "eval", measure([&](long reps) {
+            double x = 0.3;
+            for (long r = 0; r < reps; ++r)
+                x = 0.3 + 1e-30 * horner(a.data(), n, x);
+            return x;
+        }, minTimeMs));
+
+        report.add(name, "estrin_chained", "eval", measure([&](long reps) {
+            double x = 0.3;
+            for (long r = 0; r < reps; ++r)
+                x = 0.3 + 1e-30 * estrin(a.data(), n, x);
+            return x;
+        }, minTimeMs));
+
+        report.add(name, "horner_compensated", "eval", measure([&](long reps) {
+            double acc = 0.0;
+            for (long r = 0; r < reps; ++r)
+                for (size_t i = 0; i < kPoints; ++i)
+                    acc += horner_compensated(a.data(), n, xs[i]).value;
+            return acc;
+        }, minTimeMs) / kPoints);
+
+        std::vector<DoubleDouble> add(a.begin(), a.end());
+        report.add(name, "horner_double_double", "eval", measure([&](long reps) {
+            double acc = 0.0;
+            for (long r = 0; r < reps; ++r)
+                for (size_t i = 0; i < kPoints; ++i)
+                    acc += double(horner_compensated(add.data(), n, DoubleDouble(xs[i])).value);
+            return acc;
+        }, minTimeMs) / kPoints);
+
+        report.add(name, "horner_points", "eval", measure([&](long reps) {
+            double acc = 0.0;
+            for (long r = 0; r < reps; ++r) {
+                horner_points(a.data(), n, xs.data(), out.data(), kPoints);
+                acc += out[r % kPoints];
+            }
+            return acc;
+        }, minTimeMs) / kPoints);
+
+        report.add(name, "aberth_roots", "solve", measure([&](long reps) {
+            double acc = 0.0;
+            for (long r = 0; r < reps; ++r)
+                acc += solver.solve(a.data(), n).roots[0].z.real();
+            return acc;
+        }, minTimeMs));
+
+        // kPoints different polynomials of the same degree, one point each
+        std::vector<double> soa(size_t(n + 1) * kPoints);
+        for (size_t k = 0; k < soa.size(); ++k)
+            soa[k] = 1.0 / (1.0 + double(k % 97));
+
+        report.add(name, "horner_soa", "eval", measure([&](long reps) {
+            double acc = 0.0;
+            for (long r = 0; r < reps; ++r) {
+                horner_soa(soa.data(), n, kPoints, xs.data(), out.data());
+                acc += out[r % kPoints];
+            }
+            return acc;
+        }, minTimeMs) / kPoints);
+    }
+}
+
+// Per iteration row: storing it in a trace file against formatting it as
+// a line of text, which is what showing every row used to cost.
+void benchTrace(double minTimeMs, Report& report) {
+    const char* path = "secant_bench.trace";
+    RootSolver::Step step{0, 1.25, -0.5, 2.5, 0.75, 1.75, 0.125, 0.0625, true};
+
+    report.add("iteration_trace", "trace_append", "row", measure([&](long reps) {
+        TraceWriter writer(path);
+        for (long r = 0; r < reps; ++r) {
+            step.n = int(r);
+            writer.append(step);
+        }
+        writer.close();
+        return double(writer.rows());
+    }, minTimeMs));
+
+    report.add("iteration_trace", "trace_read", "row", measure([&](long reps) {
+        TraceReader reader(path);
+        double acc = 0.0;
+        for (long r = 0; r < reps; ++r)
+            acc += reader.value(r % reader.rows(), Trace::X);
+        return acc;
+    }, minTimeMs));
+    std::remove(path);
+
+    report.add("iteration_trace", "text_format", "row", measure([&](long reps) {
+        double acc = 0.0;
+        for (long r = 0; r < reps; ++r) {
+            std::stringstream row;
+            row.setf(std::ios::fixed); row.precision(6);
+            row << "|" << std::setw(4) << r
+                << " |" << std::setw(9) << step.a << " |" << std::setw(9) << step.fa
+                << " |" << std::setw(9) << step.b << " |" << std::setw(9) << step.fb
+                << " |" << std::setw(9) << step.x << " |" << std::setw(9) << step.fx
+                << " |" << std::setw(7) << step.dx << " |\n";
+            acc += double(row.str().size());
+        }
+        return acc;
+    }, minTimeMs));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    double minTimeMs = 100.0;
+    std::string filter;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--min-time-ms") == 0 && i + 1 < argc) {
+            minTimeMs = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--min-time-ms N] [--filter TEXT]" << std::endl;
+            return 2;
+        }
+    }
+
+    Report report;
+    for (const Case& c : kCorpus) {
+        if (!filter.empty() && std::string(c.name).find(filter) == std::string::npos)
+            continue;
+        std::cerr << "bench: " << c.name << std::endl;
+        benchCase(c, minTimeMs, report);
+    }
+    if (filter.empty() || std::string("horner").find(filter) != std::string::npos)
+        benchHorner(minTimeMs, report);
+    if (filter.empty() || std::string("iteration_trace").find(filter) != std::string::npos)
+        benchTrace(minTimeMs, report);
+
+    report.print(std::cout, minTimeMs);
+    return 0;
+}
@@ -5,63 +5,280 @@
 #include <limits>
 #include <sstream>
 #include <iomanip>
-#include "libs/Tokenizer.hpp"
-
-struct IterRow {
-    int n;
-    double x1, fx1;
-    double x2, fx2;
-    double x3, fx3;
-    double err;
-};
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include "libs/Solvers.hpp"
+#include "libs/RootScanner.hpp"
+#include "libs/RootIsolator.hpp"
+#include "libs/EvalMemo.hpp"
+#include "libs/ExpressionCache.hpp"
+#include "libs/Instrument.hpp"
+#include "libs/TraceFile.hpp"
 
-static double secant_next(MathParser& parser, const std::string& expr, double x1, double x2) {
-    double fx1 = parser.evaluate(expr, x1);
-    double fx2 = parser.evaluate(expr, x2);
-    if (fx2 == fx1) return std::numeric_limits<double>::quiet_NaN();
-    return x2 - (fx2 * (x2 - x1)) / (fx2 - fx1);
-}
-
-static void run_secant(MathParser& parser, const std::string& expr,
-                       double x1, double x2,
-                       bool useEps, double eps, int maxIter,
-                       std::vector<IterRow>& outRows,
-                       double& outRoot, double& outErr) {
-    outRows.clear();
-    int iteration = 0;
-    double x3 = 0.0;
-    double error = std::numeric_limits<double>::max();
-
-    int limit = useEps ? 100 : maxIter;
-
-    while ((useEps && error > eps && iteration < limit) || (!useEps && iteration < limit)) {
-        double fx1 = parser.evaluate(expr, x1);
-        double fx2 = parser.evaluate(expr, x2);
-        x3 = secant_next(parser, expr, x1, x2);
-        if (std::isnan(x3)) break;
-        double fx3 = parser.evaluate(expr, x3);
-        error = std::fabs((x3 - x2) / x3);
-        outRows.push_back({iteration, x1, fx1, x2, fx2, x3, fx3, error});
-        x1 = x2; x2 = x3; iteration++;
-    }
+typedef RootSolver::Step IterRow;
 
-    outRoot = x3;
-    outErr  = error;
-}
+// Runs longer than this keep a thinning sample of their later iterations
+// (TraceOptions::keepAll), so the trace file stays a few megabytes.
+const long kTraceKeepAll = 100000;
+
+// "Iterations as text" formats at most this many rows.
+const long kMaxTextRows = 100000;
+
+static const char* kTraceHeader =
+    "|  N |        A |      F(A) |        B |      F(B) |        X |      F(X) |  |DX| |\n";
+
+// State of the solve running on the worker thread. The worker writes the
+// iterations to the trace file and appends the rest of its output to
+// 'pending'; an idle callback on the GTK main loop moves that text into the
+// buffer and shows the new trace rows, so the window stays responsive.
+struct RunState {
+    std::thread worker;
+    std::atomic<bool> cancel{false};
+
+    std::mutex m;            // guards the fields below
+    std::string pending;     // text not yet shown
+    bool flushQueued = false;
+    bool done = false;
+
+    Instrument::Totals stats; // taken before compiling, for the summary
+};
 
 typedef struct {
     GtkEntry* entry_func;
+    GtkComboBoxText* combo_method; // entries in RootSolver::Method order
     GtkEntry* entry_x1;
     GtkEntry* entry_x2;
     GtkCheckButton* check_eps;
     GtkEntry* entry_eps;
     GtkEntry* entry_iters;
+    GtkEntry* entry_a;
+    GtkEntry* entry_b;
+    GtkWidget* btn_run;
+    GtkWidget* btn_scan;
+    GtkWidget* btn_cancel;
+    GtkWidget* btn_text;
     GtkTextBuffer* text_buffer;
+    ThreadPool* pool;
+    ExpressionCache* cache; // repeated runs of one f(x) skip the parse
+
+    // f(x) values of the last function solved; kept while the function stays
+    // the same, so re-running with the same inputs evaluates nothing new
+    SharedExpression memoFunc;
+    std::shared_ptr<EvalMemo> memo;
+    RunState* run; // non-null while a solve is in progress
+
+    // Iterations of the last solve: the worker writes them to trace_path
+    // and the view maps the file, drawing only the rows on screen
+    std::string trace_path;
+    TraceReader* trace;
+    GtkWidget* trace_area;
+    GtkAdjustment* trace_adj; // in rows
+    PangoFontDescription* trace_font;
+    int trace_line_height;     // pixels, measured on the first draw
 } AppWidgets;
 
+static void set_output(GtkTextBuffer* buffer, const std::string& text) {
+    GtkTextIter start, end;
+    gtk_text_buffer_get_start_iter(buffer, &start);
+    gtk_text_buffer_get_end_iter(buffer, &end);
+    gtk_text_buffer_delete(buffer, &start, &end);
+    gtk_text_buffer_insert_at_cursor(buffer, text.c_str(), -1);
+}
+
+static int format_trace_row(char* buf, size_t size, const IterRow& r) {
+    return std::snprintf(buf, size, "|%4d |%9.6f |%9.6f |%9.6f |%9.6f |%9.6f |%9.6f |%7.6f |\n",
+                         r.n, r.a, r.fa, r.b, r.fb, r.x, r.fx, r.dx);
+}
+
+// Picks up the rows written since the last call. While the view shows the
+// last rows it follows new ones, like a log.
+static void update_trace_view(AppWidgets* widgets) {
+    GtkAdjustment* adj = widgets->trace_adj;
+    double page = gtk_adjustment_get_page_size(adj);
+    double value = gtk_adjustment_get_value(adj);
+    bool follow = value + page >= gtk_adjustment_get_upper(adj);
+
+    double rows = double(widgets->trace->refresh());
+    if (follow) value = std::max(0.0, rows - page);
+    gtk_adjustment_configure(adj, value, 0, rows, 1, page, page);
+    gtk_widget_queue_draw(widgets->trace_area);
+}
+
+// Formats only the rows that fit in the window; the file may hold millions.
+static gboolean on_trace_draw(GtkWidget* widget, cairo_t* cr, gpointer user_data) {
+    AppWidgets* widgets = (AppWidgets*)user_data;
+    PangoLayout* layout = gtk_widget_create_pango_layout(widget, NULL);
+    pango_layout_set_font_description(layout, widgets->trace_font);
+    if (widgets->trace_line_height == 0) {
+        int width;
+        pango_layout_set_text(layout, "|", -1);
+        pango_layout_get_pixel_size(layout, &width, &widgets->trace_line_height);
+    }
+
+    // The page is what fits below the header; it changes with the window
+    GtkAdjustment* adj = widgets->trace_adj;
+    int visible = std::max(1, gtk_widget_get_allocated_height(widget) / widgets->trace_line_height - 2);
+    if (gtk_adjustment_get_page_size(adj) != visible) {
+        gtk_adjustment_configure(adj, gtk_adjustment_get_value(adj), 0, double(widgets->trace->rows()),
+                                 1, visible, visible);
+    }
+
+    std::string text = std::string(kTraceHeader) + std::string(86, '-') + "\n";
+    long first = long(gtk_adjustment_get_value(adj));
+    long last = std::min(widgets->trace->rows(), first + visible);
+    char line[160];
+    for (long i = first; i < last; ++i) {
+        format_trace_row(line, sizeof line, widgets->trace->row(i));
+        text += line;
+    }
+
+    pango_layout_set_text(layout, text.c_str(), -1);
+    cairo_move_to(cr, 0, 0);
+    pango_cairo_show_layout(cr, layout);
+    g_object_unref(layout);
+    return FALSE;
+}
+
+static gboolean on_trace_scroll(GtkWidget* /*widget*/, GdkEventScroll* event, gpointer user_data) {
+    AppWidgets* widgets = (AppWidgets*)user_data;
+    double dy = 0;
+    if (event->direction == GDK_SCROLL_UP) dy = -1;
+    else if (event->direction == GDK_SCROLL_DOWN) dy = 1;
+    else if (event->direction == GDK_SCROLL_SMOOTH) dy = event->delta_y;
+
+    GtkAdjustment* adj = widgets->trace_adj;
+    gtk_adjustment_set_value(adj, gtk_adjustment_get_value(adj) + 3 * dy);
+    return TRUE;
+}
+
+static void on_trace_scrolled(GtkAdjustment* /*adj*/, gpointer user_data) {
+    gtk_widget_queue_draw(((AppWidgets*)user_data)->trace_area);
+}
+
+static void set_running(AppWidgets* widgets, bool running) {
+    gtk_widget_set_sensitive(widgets->btn_run, !running);
+    gtk_widget_set_sensitive(widgets->btn_scan, !running);
+    gtk_widget_set_sensitive(widgets->btn_cancel, running);
+}
+
+// Main loop side: appends whatever the worker produced since the last call
+// and, once the worker is done, joins it and re-enables the buttons.
+static gboolean flush_output(gpointer user_data) {
+    AppWidgets* widgets = (AppWidgets*)user_data;
+    RunState* st = widgets->run;
+
+    std::string text;
+    bool done;
+    {
+        std::lock_guard<std::mutex> lock(st->m);
+        text.swap(st->pending);
+        st->flushQueued = false;
+        done = st->done;
+    }
+
+    GtkTextIter end;
+    gtk_text_buffer_get_end_iter(widgets->text_buffer, &end);
+    gtk_text_buffer_insert(widgets->text_buffer, &end, text.c_str(), -1);
+    update_trace_view(widgets);
+
+    if (done) {
+        st->worker.join();
+        delete st;
+        widgets->run = nullptr;
+        set_running(widgets, false);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+// Worker side: queues text for the main loop. Only one idle callback is
+// pending at a time, so fast producers get their rows batched together.
+static void post_output(AppWidgets* widgets, const std::string& text, bool finished) {
+    RunState* st = widgets->run;
+    bool schedule;
+    {
+        std::lock_guard<std::mutex> lock(st->m);
+        st->pending += text;
+        if (finished) st->done = true;
+        schedule = !st->flushQueued;
+        st->flushQueued = true;
+    }
+    if (schedule) g_idle_add(flush_output, widgets);
+}
+
+static void start_run(AppWidgets* widgets, const Instrument::Totals& stats, const std::string& header,
+                      std::function<void(AppWidgets*, RunState*)> body) {
+    set_output(widgets->text_buffer, header);
+    set_running(widgets, true);
+    widgets->run = new RunState;
+    widgets->run->stats = stats;
+    widgets->run->worker = std::thread(body, widgets, widgets->run);
+}
+
+static void run_solver(AppWidgets* widgets, RunState* st,
+                       SharedExpression f, std::shared_ptr<EvalMemo> memo, std::shared_ptr<TraceWriter> trace,
+                       RootSolver::Method method, double x1, double x2, bool useEps, double eps, int maxIter) {
+    // Without EPS only the iteration limit (or an exact root) stops the run
+    SolveOptions opts;
+    opts.maxIter = useEps ? 100 : maxIter;
+    opts.xAbsTol = useEps ? eps : 0.0;
+    opts.xRelTol = useEps ? eps : 0.0;
+
+    RootSolver solver(*f, method, x1, x2, opts, memo.get());
+    IterRow r{};
+    std::string traceError;
+
+    // Rows are stored, not formatted; the view is told about them a few
+    // times a second
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point lastShown = Clock::now();
+    try {
+        while (!st->cancel && solver.step(r)) {
+            trace->append(r);
+            if (Clock::now() - lastShown > std::chrono::milliseconds(50)) {
+                trace->flush();
+                post_output(widgets, "", false);
+                lastShown = Clock::now();
+            }
+        }
+        trace->close();
+    } catch (const std::exception& e) {
+        traceError = e.what();
+    }
+
+    std::stringstream ss;
+    ss.setf(std::ios::fixed); ss.precision(6);
+    if (!traceError.empty())
+        ss << "Stopped: " << traceError << "\n";
+    else if (st->cancel)
+        ss << "Cancelled after " << solver.iterations() << " iterations\n";
+    else if (!useEps && solver.status() == RootSolver::MAX_ITERATIONS)
+        ss << "Done after " << solver.iterations() << " iterations\n";
+    else
+        ss << "Status: " << RootSolver::statusName(solver.status())
+           << " after " << solver.iterations() << " iterations\n";
+    ss << "Root: " << solver.root() << "\n";
+    ss << "F(root): " << std::scientific << solver.value() << std::fixed << "\n";
+    ss << "Function evaluations: " << solver.evaluations() << "\n";
+    if (trace->rows() < trace->steps())
+        ss << "Iterations in the table: " << trace->rows() << " of " << trace->steps() << "\n";
+    ss.precision(1);
+    ss << "Memo hits: " << memo->hits() << " of " << memo->lookups()
+       << " (" << 100.0 * memo->hitRate() << "%)\n";
+    if (Instrument::enabled) ss << "\n" << Instrument::summary(st->stats);
+    post_output(widgets, ss.str(), true);
+}
+
 static void on_run_clicked(GtkButton* /*button*/, gpointer user_data) {
     AppWidgets* widgets = (AppWidgets*)user_data;
-    MathParser parser;
+    if (widgets->run) return;
+    Instrument::Totals stats = Instrument::totals();
 
     std::string expr = gtk_entry_get_text(widgets->entry_func);
     double x1 = atof(gtk_entry_get_text(widgets->entry_x1));
@@ -69,38 +286,123 @@ static void on_run_clicked(GtkButton* /*button*/, gpointer user_data) {
     bool useEps = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(widgets->check_eps));
     double eps = atof(gtk_entry_get_text(widgets->entry_eps));
     int iters = atoi(gtk_entry_get_text(widgets->entry_iters));
+    RootSolver::Method method = RootSolver::Method(gtk_combo_box_get_active(GTK_COMBO_BOX(widgets->combo_method)));
 
-    std::vector<IterRow> rows;
-    double root = 0.0, lastErr = 0.0;
+    SharedExpression f;
+    try {
+        f = widgets->cache->get(expr);
+    } catch (const std::exception& e) {
+        set_output(widgets->text_buffer, std::string("Error: ") + e.what() + "\n");
+        return;
+    }
 
-    std::stringstream ss;
+    // One run at a time, so the worker has the memo to itself
+    if (widgets->memoFunc != f) {
+        widgets->memoFunc = f;
+        widgets->memo = std::make_shared<EvalMemo>(*f);
+    }
+    std::shared_ptr<EvalMemo> memo = widgets->memo;
+
+    // The view lets go of the last trace before the file is truncated
+    TraceOptions traceOpts;
+    traceOpts.keepAll = kTraceKeepAll;
+    std::shared_ptr<TraceWriter> trace;
+    widgets->trace->close();
     try {
-        run_secant(parser, expr, x1, x2, useEps, eps, iters, rows, root, lastErr);
+        trace = std::make_shared<TraceWriter>(widgets->trace_path, traceOpts);
+        widgets->trace->open(widgets->trace_path);
+    } catch (const std::exception& e) {
+        update_trace_view(widgets);
+        set_output(widgets->text_buffer, std::string("Error: ") + e.what() + "\n");
+        return;
+    }
+    update_trace_view(widgets);
+
+    start_run(widgets, stats, "", [=](AppWidgets* w, RunState* st) {
+        run_solver(w, st, f, memo, trace, method, x1, x2, useEps, eps, iters);
+    });
+}
+
+static void on_scan_clicked(GtkButton* /*button*/, gpointer user_data) {
+    AppWidgets* widgets = (AppWidgets*)user_data;
+    if (widgets->run) return;
+    Instrument::Totals stats = Instrument::totals();
+
+    std::string expr = gtk_entry_get_text(widgets->entry_func);
+    double a = atof(gtk_entry_get_text(widgets->entry_a));
+    double b = atof(gtk_entry_get_text(widgets->entry_b));
+
+    SharedExpression f;
+    try {
+        f = widgets->cache->get(expr);
+    } catch (const std::exception& e) {
+        set_output(widgets->text_buffer, std::string("Error: ") + e.what() + "\n");
+        return;
+    }
+
+    widgets->trace->close();
+    update_trace_view(widgets);
+
+    std::stringstream header;
+    header.setf(std::ios::fixed); header.precision(6);
+    header << "Roots on [" << a << ", " << b << "]:\n";
+    header << "|  N |            X |         F(X) | EVALS |\n";
+    header << std::string(46, '-') << "\n";
+
+    start_run(widgets, stats, header.str(), [=](AppWidgets* w, RunState* st) {
+        // Interval arithmetic rules out most of [a, b] without sampling it
+        // Cancel stops the search between boxes and skips the unsolved brackets
+        IsolateOptions opts;
+        opts.cancel = &st->cancel;
+        RootIsolator isolator(*f, *w->pool);
+        RootIsolator::Isolation isolation = isolator.isolate(a, b, opts);
+        std::vector<RootScanner::Root> roots;
+        if (!st->cancel) roots = isolator.solve(isolation, opts);
+
+        std::stringstream ss;
         ss.setf(std::ios::fixed); ss.precision(6);
-        ss << "|  N |       X1 |     F(X1) |       X2 |     F(X2) |       X3 |     F(X3) |   ERR |\n";
-        ss << std::string(86, '-') << "\n";
-        for (const auto& r : rows) {
-            ss << "|" << std::setw(4) << r.n
-               << " |" << std::setw(9) << r.x1
-               << " |" << std::setw(9) << r.fx1
-               << " |" << std::setw(9) << r.x2
-               << " |" << std::setw(9) << r.fx2
-               << " |" << std::setw(9) << r.x3
-               << " |" << std::setw(9) << r.fx3
-               << " |" << std::setw(7) << r.err << " |\n";
+        if (st->cancel) {
+            ss << "Cancelled\n";
+        } else {
+            for (size_t i = 0; i < roots.size(); ++i) {
+                ss << "|" << std::setw(4) << i
+                   << " |" << std::setw(13) << roots[i].x
+                   << " |" << std::setw(13) << std::scientific << roots[i].fx << std::fixed
+                   << " |" << std::setw(6) << roots[i].evaluations << " |\n";
+            }
+            ss << std::string(46, '-') << "\n";
+            ss << roots.size() << " root(s) found\n";
+            ss << isolation.boxes << " boxes searched, " << isolation.pruned << " ruled out\n";
         }
-        ss << std::string(86, '-') << "\n";
-        ss << "Root: " << root << "\n";
-        ss << "Final Error: " << lastErr << "\n";
-    } catch (const std::exception& e) {
-        ss << "Error: " << e.what() << "\n";
+        if (Instrument::enabled) ss << "\n" << Instrument::summary(st->stats);
+        post_output(w, ss.str(), true);
+    });
+}
+
+static void on_cancel_clicked(GtkButton* /*button*/, gpointer user_data) {
+    AppWidgets* widgets = (AppWidgets*)user_data;
+    if (widgets->run) widgets->run->cancel = true;
+}
+
+// The only place the trace is formatted in full, and only when asked for.
+static void on_text_clicked(GtkButton* /*button*/, gpointer user_data) {
+    AppWidgets* widgets = (AppWidgets*)user_data;
+    long rows = widgets->trace->refresh();
+    long count = std::min(rows, kMaxTextRows);
+
+    std::string text = "\n" + std::string(kTraceHeader) + std::string(86, '-') + "\n";
+    text.reserve(text.size() + size_t(count) * 90);
+    char line[160];
+    for (long i = 0; i < count; ++i) {
+        format_trace_row(line, sizeof line, widgets->trace->row(i));
+        text += line;
     }
+    text += std::string(86, '-') + "\n";
+    if (count < rows) text += "First " + std::to_string(count) + " of " + std::to_string(rows) + " rows\n";
 
-    GtkTextIter start, end;
-    gtk_text_buffer_get_start_iter(widgets->text_buffer, &start);
+    GtkTextIter end;
     gtk_text_buffer_get_end_iter(widgets->text_buffer, &end);
-    gtk_text_buffer_delete(widgets->text_buffer, &start, &end);
-    gtk_text_buffer_insert_at_cursor(widgets->text_buffer, ss.str().c_str(), -1);
+    gtk_text_buffer_insert(widgets->text_buffer, &end, text.c_str(), -1);
 }
 
 int main(int argc, char** argv) {
@@ -117,12 +419,29 @@ int main(int argc, char** argv) {
     gtk_container_add(GTK_CONTAINER(window), grid);
 
     AppWidgets widgets{};
+    ThreadPool pool;
+    ExpressionCache cache(64);
+    TraceReader trace;
+    widgets.pool = &pool;
+    widgets.cache = &cache;
+    widgets.trace = &trace;
+    widgets.trace_path = std::string(g_get_tmp_dir()) + "/secant-gtk-" + std::to_string(getpid()) + ".trace";
+    widgets.trace_font = pango_font_description_from_string("Monospace");
 
     // Labels and entries
     GtkWidget* lbl_func = gtk_label_new("f(x):");
     widgets.entry_func = GTK_ENTRY(gtk_entry_new());
     gtk_entry_set_text(widgets.entry_func, "x^2 - 4x - 10");
 
+    GtkWidget* lbl_method = gtk_label_new("Method:");
+    widgets.combo_method = GTK_COMBO_BOX_TEXT(gtk_combo_box_text_new());
+    gtk_combo_box_text_append_text(widgets.combo_method, "Secant");
+    gtk_combo_box_text_append_text(widgets.combo_method, "Brent");
+    gtk_combo_box_text_append_text(widgets.combo_method, "Illinois");
+    gtk_combo_box_text_append_text(widgets.combo_method, "Anderson-Bjorck");
+    gtk_combo_box_text_append_text(widgets.combo_method, "Steffensen");
+    gtk_combo_box_set_active(GTK_COMBO_BOX(widgets.combo_method), RootSolver::SECANT);
+
     GtkWidget* lbl_x1 = gtk_label_new("x1:");
     widgets.entry_x1 = GTK_ENTRY(gtk_entry_new());
     gtk_entry_set_text(widgets.entry_x1, "0");
@@ -142,8 +461,40 @@ int main(int argc, char** argv) {
     widgets.entry_iters = GTK_ENTRY(gtk_entry_new());
     gtk_entry_set_text(widgets.entry_iters, "5");
 
-    GtkWidget* btn_run = gtk_button_new_with_label("Run");
-    g_signal_connect(btn_run, "clicked", G_CALLBACK(on_run_clicked), &widgets);
+    GtkWidget* lbl_a = gtk_label_new("a:");
+    widgets.entry_a = GTK_ENTRY(gtk_entry_new());
+    gtk_entry_set_text(widgets.entry_a, "-10");
+
+    GtkWidget* lbl_b = gtk_label_new("b:");
+    widgets.entry_b = GTK_ENTRY(gtk_entry_new());
+    gtk_entry_set_text(widgets.entry_b, "10");
+
+    widgets.btn_run = gtk_button_new_with_label("Run");
+    g_signal_connect(widgets.btn_run, "clicked", G_CALLBACK(on_run_clicked), &widgets);
+
+    widgets.btn_scan = gtk_button_new_with_label("Find all roots in [a, b]");
+    g_signal_connect(widgets.btn_scan, "clicked", G_CALLBACK(on_scan_clicked), &widgets);
+
+    widgets.btn_cancel = gtk_button_new_with_label("Cancel");
+    g_signal_connect(widgets.btn_cancel, "clicked", G_CALLBACK(on_cancel_clicked), &widgets);
+    gtk_widget_set_sensitive(widgets.btn_cancel, FALSE);
+
+    widgets.btn_text = gtk_button_new_with_label("Iterations as text");
+    g_signal_connect(widgets.btn_text, "clicked", G_CALLBACK(on_text_clicked), &widgets);
+
+    // Iteration table: a drawing area that renders the visible rows of the
+    // trace, scrolled by row through trace_adj
+    widgets.trace_adj = gtk_adjustment_new(0, 0, 0, 1, 10, 10);
+    g_signal_connect(widgets.trace_adj, "value-changed", G_CALLBACK(on_trace_scrolled), &widgets);
+    widgets.trace_area = gtk_drawing_area_new();
+    gtk_widget_add_events(widgets.trace_area, GDK_SCROLL_MASK | GDK_SMOOTH_SCROLL_MASK);
+    g_signal_connect(widgets.trace_area, "draw", G_CALLBACK(on_trace_draw), &widgets);
+    g_signal_connect(widgets.trace_area, "scroll-event", G_CALLBACK(on_trace_scroll), &widgets);
+    gtk_widget_set_size_request(widgets.trace_area, -1, 120);
+    GtkWidget* trace_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
+    gtk_box_pack_start(GTK_BOX(trace_box), widgets.trace_area, TRUE, TRUE, 0);
+    gtk_box_pack_start(GTK_BOX(trace_box), gtk_scrollbar_new(GTK_ORIENTATION_VERTICAL, widgets.trace_adj),
+                       FALSE, FALSE, 0);
 
     GtkWidget* scrolled = gtk_scrolled_window_new(NULL, NULL);
     gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(scrolled), GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
@@ -152,11 +503,18 @@ int main(int argc, char** argv) {
     widgets.text_buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(textview));
     gtk_container_add(GTK_CONTAINER(scrolled), textview);
 
+    GtkWidget* paned = gtk_paned_new(GTK_ORIENTATION_VERTICAL);
+    gtk_paned_pack1(GTK_PANED(paned), trace_box, TRUE, FALSE);
+    gtk_paned_pack2(GTK_PANED(paned), scrolled, TRUE, FALSE);
+
     // Layout
     int r = 0;
     gtk_grid_attach(GTK_GRID(grid), lbl_func,   0, r, 1, 1);
     gtk_grid_attach(GTK_GRID(grid), GTK_WIDGET(widgets.entry_func), 1, r, 3, 1); r++;
 
+    gtk_grid_attach(GTK_GRID(grid), lbl_method, 0, r, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), GTK_WIDGET(widgets.combo_method), 1, r, 3, 1); r++;
+
     gtk_grid_attach(GTK_GRID(grid), lbl_x1,     0, r, 1, 1);
     gtk_grid_attach(GTK_GRID(grid), GTK_WIDGET(widgets.entry_x1),   1, r, 1, 1);
     gtk_grid_attach(GTK_GRID(grid), lbl_x2,     2, r, 1, 1);
@@ -168,13 +526,31 @@ int main(int argc, char** argv) {
     gtk_grid_attach(GTK_GRID(grid), lbl_iters,  3, r, 1, 1); r++;
     gtk_grid_attach(GTK_GRID(grid), GTK_WIDGET(widgets.entry_iters), 3, r, 1, 1); r++;
 
-    gtk_grid_attach(GTK_GRID(grid), btn_run, 0, r, 4, 1); r++;
+    gtk_grid_attach(GTK_GRID(grid), lbl_a,      0, r, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), GTK_WIDGET(widgets.entry_a),    1, r, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), lbl_b,      2, r, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), GTK_WIDGET(widgets.entry_b),    3, r, 1, 1); r++;
 
-    gtk_grid_attach(GTK_GRID(grid), scrolled, 0, r, 4, 1);
-    gtk_widget_set_vexpand(scrolled, TRUE);
-    gtk_widget_set_hexpand(scrolled, TRUE);
+    gtk_grid_attach(GTK_GRID(grid), widgets.btn_run,    0, r, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), widgets.btn_scan,   1, r, 2, 1);
+    gtk_grid_attach(GTK_GRID(grid), widgets.btn_cancel, 3, r, 1, 1); r++;
+    gtk_grid_attach(GTK_GRID(grid), widgets.btn_text,   3, r, 1, 1); r++;
+
+    gtk_grid_attach(GTK_GRID(grid), paned, 0, r, 4, 1);
+    gtk_widget_set_vexpand(paned, TRUE);
+    gtk_widget_set_hexpand(paned, TRUE);
 
     gtk_widget_show_all(window);
     gtk_main();
+
+    // The window is gone; stop a solve that is still running
+    if (widgets.run) {
+        widgets.run->cancel = true;
+        widgets.run->worker.join();
+        delete widgets.run;
+    }
+    trace.close();
+    std::remove(widgets.trace_path.c_str());
+    pango_font_description_free(widgets.trace_font);
     return 0;
 }
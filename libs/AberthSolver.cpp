@@ -0,0 +1,270 @@
+#include "AberthSolver.hpp"
+#include "Horner.hpp"
+#include "Instrument.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+// Approximations updated together; matches the blocking in Horner.cpp.
+const size_t kBlock = 64;
+
+// Offset of the starting angles, so no approximation starts on the real
+// axis or in a symmetric position (Bini 1996).
+const double kAngleOffset = 0.7;
+
+// Everything one iteration reads and writes. Blocks of approximations are
+// independent: each reads re/im and writes only its own part of
+// nextRe/nextIm, radius and active.
+struct Iteration {
+    int n;
+    const double* coef;    // p, scaled by a power of two
+    const double* rev;     // x^n p(1/x), for approximations outside the unit circle
+    const double* absCoef; // |coefficients|, for the rounding level
+    const double* absRev;
+    const double* re;
+    const double* im;
+    double* nextRe;
+    double* nextIm;
+    double* radius;
+    unsigned char* active;
+
+    void step(size_t begin, size_t end) const;
+};
+
+void Iteration::step(size_t begin, size_t end) const {
+    size_t idx[kBlock];
+    double zr[kBlock], zi[kBlock]; // where p (or rev) is evaluated
+    double pr[kBlock], pi[kBlock], dr[kBlock], di[kBlock];
+    double mod[kBlock], level[kBlock];
+    double xr[kBlock], xi[kBlock], sr[kBlock], si[kBlock];
+
+    // Active approximations inside the unit circle fill the lanes from the
+    // front, the others from the back, evaluated at 1/z so nothing overflows
+    size_t inner = 0, outer = end - begin;
+    for (size_t i = begin; i < end; ++i) {
+        nextRe[i] = re[i];
+        nextIm[i] = im[i];
+        if (!active[i]) continue;
+
+        double m2 = re[i] * re[i] + im[i] * im[i];
+        if (m2 <= 1.0) {
+            idx[inner] = i;
+            zr[inner] = re[i];
+            zi[inner] = im[i];
+            inner++;
+        } else {
+            outer--;
+            idx[outer] = i;
+            zr[outer] = re[i] / m2;
+            zi[outer] = -im[i] / m2;
+        }
+    }
+
+    // Compact the outer lanes down to follow the inner ones
+    size_t lanes = inner;
+    for (size_t k = outer; k < end - begin; ++k, ++lanes) {
+        idx[lanes] = idx[k];
+        zr[lanes] = zr[k];
+        zi[lanes] = zi[k];
+    }
+    if (lanes == 0) return;
+
+    for (size_t k = 0; k < lanes; ++k)
+        mod[k] = std::sqrt(zr[k] * zr[k] + zi[k] * zi[k]);
+
+    horner_complex_points(coef, n, zr, zi, pr, pi, dr, di, inner);
+    horner_complex_points(rev, n, zr + inner, zi + inner, pr + inner, pi + inner,
+                          dr + inner, di + inner, lanes - inner);
+    horner_points(absCoef, n, mod, level, inner);
+    horner_points(absRev, n, mod + inner, level + inner, lanes - inner);
+
+    // Aberth's sum over the other approximations, one lane per root
+    for (size_t k = 0; k < lanes; ++k) {
+        xr[k] = re[idx[k]];
+        xi[k] = im[idx[k]];
+        sr[k] = 0.0;
+        si[k] = 0.0;
+    }
+    for (size_t j = 0; j < size_t(n); ++j) {
+        double rj = re[j], ij = im[j];
+        for (size_t k = 0; k < lanes; ++k) {
+            double dx = xr[k] - rj, dy = xi[k] - ij;
+            double inv = (idx[k] == j) ? 0.0 : 1.0 / (dx * dx + dy * dy);
+            sr[k] += dx * inv;
+            si[k] -= dy * inv;
+        }
+    }
+
+    const double noise = 4.0 * (n + 1) * DBL_EPSILON;
+    for (size_t k = 0; k < lanes; ++k) {
+        size_t i = idx[k];
+        double p2 = pr[k] * pr[k] + pi[k] * pi[k];
+        if (p2 == 0.0) {
+            radius[i] = 0.0;
+            active[i] = 0;
+            continue;
+        }
+
+        // p'/p, or for the reversed polynomial R at w = 1/z,
+        // p'(z)/p(z) = n w - w^2 R'(w)/R(w)
+        double qr = (dr[k] * pr[k] + di[k] * pi[k]) / p2;
+        double qi = (di[k] * pr[k] - dr[k] * pi[k]) / p2;
+        if (k >= inner) {
+            double wr = zr[k], wi = zi[k];
+            double w2r = wr * wr - wi * wi, w2i = 2.0 * wr * wi;
+            double tr = w2r * qr - w2i * qi, ti = w2r * qi + w2i * qr;
+            qr = n * wr - tr;
+            qi = n * wi - ti;
+        }
+        radius[i] = n / std::sqrt(qr * qr + qi * qi);
+
+        // At the rounding level another step would only add noise
+        if (std::sqrt(p2) <= noise * level[k]) {
+            active[i] = 0;
+            continue;
+        }
+
+        // z -= 1 / (p'/p - sum), the Newton step on p / prod (x - z_j)
+        double er = qr - sr[k], ei = qi - si[k];
+        double e2 = er * er + ei * ei;
+        double cr = er / e2, ci = -ei / e2;
+        double step2 = cr * cr + ci * ci;
+        if (!std::isfinite(step2)) continue;
+
+        nextRe[i] = xr[k] - cr;
+        nextIm[i] = xi[k] - ci;
+        radius[i] += std::sqrt(step2); // the disk was centred on the old z
+        if (step2 <= DBL_EPSILON * DBL_EPSILON * (xr[k] * xr[k] + xi[k] * xi[k]))
+            active[i] = 0;
+    }
+}
+
+// Starting points on circles read off the Newton polygon of p: the upper
+// convex hull of (k, log|c_k|), with c_k the coefficient of x^k. A hull edge
+// from k0 to k1 puts k1 - k0 points on a circle of radius
+// (|c_k0| / |c_k1|)^(1 / (k1 - k0)), so roots of very different sizes each
+// get starting points of about the right size.
+void startingPoints(const double* coef, int n, double* re, double* im) {
+    std::vector<int> hull;
+    auto logc = [&](int k) { return std::log(std::fabs(coef[n - k])); };
+
+    for (int k = 0; k <= n; ++k) {
+        if (coef[n - k] == 0.0) continue;
+        while (hull.size() >= 2) {
+            int k0 = hull[hull.size() - 2], k1 = hull.back();
+            // Drop k1 if it lies on or below the line from k0 to k
+            if ((logc(k1) - logc(k0)) * (k - k0) <= (logc(k) - logc(k0)) * (k1 - k0))
+                hull.pop_back();
+            else
+                break;
+        }
+        hull.push_back(k);
+    }
+
+    const double twoPi = 2.0 * std::acos(-1.0);
+    int next = 0;
+    for (size_t h = 0; h + 1 < hull.size(); ++h) {
+        int k0 = hull[h], k1 = hull[h + 1], m = k1 - k0;
+        double r = std::exp((logc(k0) - logc(k1)) / m);
+        for (int j = 0; j < m; ++j, ++next) {
+            double angle = twoPi * j / m + twoPi * k0 / n + kAngleOffset;
+            re[next] = r * std::cos(angle);
+            im[next] = r * std::sin(angle);
+        }
+    }
+}
+
+} // namespace
+
+AberthSolver::AberthSolver(ThreadPool* pool) : pool(pool) {}
+
+AberthSolver::Result AberthSolver::solve(const double* a, int n, const AberthOptions& opts) const {
+    while (n >= 0 && a[0] == 0.0) { ++a; --n; }
+    if (n < 0)
+        throw std::runtime_error("The zero polynomial has no isolated roots");
+
+    Result result;
+    result.iterations = 0;
+
+    int zeros = 0;
+    while (n > 0 && a[n] == 0.0) { --n; ++zeros; }
+    for (int i = 0; i < zeros; ++i)
+        result.roots.push_back({0.0, 0.0, true});
+
+    if (n > 0) {
+        // Scale by a power of two halfway between the largest and smallest
+        // coefficient, so neither end overflows or underflows
+        int hiExp = INT_MIN, loExp = INT_MAX;
+        for (int i = 0; i <= n; ++i) {
+            if (a[i] == 0.0) continue;
+            int e = std::ilogb(a[i]);
+            hiExp = std::max(hiExp, e);
+            loExp = std::min(loExp, e);
+        }
+        int shift = -(hiExp + loExp) / 2;
+
+        std::vector<double> coef(n + 1), rev(n + 1), absCoef(n + 1), absRev(n + 1);
+        for (int i = 0; i <= n; ++i) {
+            coef[i] = std::ldexp(a[i], shift);
+            absCoef[i] = std::fabs(coef[i]);
+        }
+        for (int i = 0; i <= n; ++i) {
+            rev[i] = coef[n - i];
+            absRev[i] = absCoef[n - i];
+        }
+
+        std::vector<double> re(n), im(n), nextRe(n), nextIm(n), radius(n, INFINITY);
+        std::vector<unsigned char> active(n, 1);
+        startingPoints(coef.data(), n, re.data(), im.data());
+
+        Iteration iter{n, coef.data(), rev.data(), absCoef.data(), absRev.data(),
+                       re.data(), im.data(), nextRe.data(), nextIm.data(),
+                       radius.data(), active.data()};
+        bool parallel = pool && pool->size() > 1 && n >= opts.parallelMinDegree;
+        size_t count = size_t(n);
+
+        while (result.iterations < opts.maxIter &&
+               std::find(active.begin(), active.end(), 1) != active.end()) {
+            INSTR_COUNT(ITERATIONS, 1);
+            result.iterations++;
+
+            if (parallel) {
+                // Only this iteration's blocks: the pool may be shared, and
+                // solve() may itself be running on one of its workers
+                TaskGroup tasks(*pool);
+                for (size_t begin = 0; begin < count; begin += kBlock) {
+                    size_t end = std::min(begin + kBlock, count);
+                    tasks.submit([&iter, begin, end] { iter.step(begin, end); });
+                }
+                tasks.wait();
+            } else {
+                for (size_t begin = 0; begin < count; begin += kBlock)
+                    iter.step(begin, std::min(begin + kBlock, count));
+            }
+
+            re.swap(nextRe);
+            im.swap(nextIm);
+            iter.re = re.data();
+            iter.im = im.data();
+            iter.nextRe = nextRe.data();
+            iter.nextIm = nextIm.data();
+        }
+
+        for (int i = 0; i < n; ++i) {
+            Root r{{re[i], im[i]}, radius[i], !active[i]};
+            if (r.converged && std::fabs(r.z.imag()) <= r.radius)
+                r.z = r.z.real();
+            result.roots.push_back(r);
+        }
+    }
+
+    std::sort(result.roots.begin(), result.roots.end(), [](const Root& l, const Root& r) {
+        if (l.z.real() != r.z.real()) return l.z.real() < r.z.real();
+        return l.z.imag() < r.z.imag();
+    });
+    return result;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <complex>
+#include <vector>
+#include "ThreadPool.hpp"
+
+struct AberthOptions {
+    int maxIter = 200;           // simultaneous iterations
+    int parallelMinDegree = 128; // smaller problems stay on the calling thread
+};
+
+// Finds every real and complex root of a real polynomial at once with the
+// Aberth-Ehrlich iteration. Coefficients are highest degree first, as in
+// Horner.hpp. Each iteration moves all approximations together: a Newton
+// step on p divided by the factors (x - z_j) of the other approximations,
+// which keeps them from converging to the same root, so no explicit
+// deflation (and none of its error build-up) is needed. Convergence is
+// cubic for simple roots.
+//
+// p and p' come from one synthetic-division pass of Horner's rule at a block
+// of approximations (horner_complex_points), and the corrections of a block
+// are computed lane by lane so both loops vectorize. Blocks are spread over
+// the pool for large degrees.
+class AberthSolver {
+public:
+    struct Root {
+        std::complex<double> z;
+        double radius;  // the disk of this radius around z contains a root of p
+        bool converged; // |p(z)| reached the rounding level of its evaluation
+    };
+
+    struct Result {
+        std::vector<Root> roots; // sorted by real part, then imaginary part
+        int iterations;
+    };
+
+    // pool may be null, and then everything runs on the calling thread.
+    explicit AberthSolver(ThreadPool* pool = nullptr);
+
+    // Roots of a[0] x^n + ... + a[n]. Leading zero coefficients lower the
+    // degree; trailing ones give exact roots at 0. Roots whose disk crosses
+    // the real axis are reported as real. Throws for the zero polynomial.
+    Result solve(const double* a, int n, const AberthOptions& opts = AberthOptions()) const;
+
+private:
+    ThreadPool* pool;
+};
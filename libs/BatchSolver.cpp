@@ -0,0 +1,347 @@
+#include "BatchSolver.hpp"
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <istream>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+
+namespace {
+
+// Distinct expressions kept parsed at once; the least recently used go first.
+const size_t kMaxCachedExpressions = 1024;
+
+const int kDefaultMaxIter = 100;
+const int kMaxMaxIter = 100000; // largest "max_iter" a job may ask for
+
+std::string trim(const std::string& s) {
+    size_t b = s.find_first_not_of(" \t\r\n");
+    if (b == std::string::npos) return "";
+    size_t e = s.find_last_not_of(" \t\r\n");
+    return s.substr(b, e - b + 1);
+}
+
+// std::getline without unbounded growth: a line longer than limit is read
+// to its end but only its first limit bytes are kept, and tooLong is set.
+bool readLine(std::istream& in, std::string& line, size_t limit, bool& tooLong) {
+    line.clear();
+    tooLong = false;
+    std::streambuf* sb = in.rdbuf();
+    for (;;) {
+        int c = sb->sbumpc();
+        if (c == std::char_traits<char>::eof()) {
+            in.setstate(std::ios::eofbit);
+            return !line.empty() || tooLong;
+        }
+        if (c == '\n') return true;
+        if (line.size() < limit) line += char(c);
+        else tooLong = true;
+    }
+}
+
+bool parseNumber(const std::string& text, double& out) {
+    std::string t = trim(text);
+    if (t.empty()) return false;
+    char* end = nullptr;
+    out = std::strtod(t.c_str(), &end);
+    return *end == '\0';
+}
+
+// eps: finite and not negative.
+bool parseTolerance(const std::string& text, double& out) {
+    return parseNumber(text, out) && std::isfinite(out) && out >= 0.0;
+}
+
+// max_iter: a whole number in [1, kMaxMaxIter].
+bool parseIterations(const std::string& text, int& out) {
+    double v;
+    if (!parseNumber(text, v) || !(v >= 1.0 && v <= kMaxMaxIter) || v != std::floor(v)) return false;
+    out = int(v);
+    return true;
+}
+
+// A job with every field at its default.
+BatchSolver::Job blankJob(long lineNo) {
+    return {lineNo, "", false, "", 0.0, 0.0, 0.0, kDefaultMaxIter, RootSolver::BRENT, BatchSolver::SOLVE};
+}
+
+std::string jsonEscape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') { out += '\\'; out += c; }
+        else if (c == '\n') out += "\\n";
+        else out += c;
+    }
+    return out;
+}
+
+// JSON has no NaN or infinity literals.
+std::string jsonNumber(double v) {
+    if (!std::isfinite(v)) return "null";
+    char buf[32];
+    std::snprintf(buf, sizeof buf, "%.17g", v);
+    return buf;
+}
+
+// Minimal reader for one flat JSON object of string and number values.
+// Values are returned as raw text, except strings, which are unescaped.
+class FlatJson {
+public:
+    explicit FlatJson(const std::string& s) : s(s) {}
+
+    bool parse(std::map<std::string, std::string>& values, std::map<std::string, std::string>& raw) {
+        skipWs();
+        if (!eat('{')) return false;
+        skipWs();
+        if (eat('}')) return true;
+
+        for (;;) {
+            std::string key;
+            skipWs();
+            if (!readString(key)) return false;
+            skipWs();
+            if (!eat(':')) return false;
+            skipWs();
+
+            size_t start = i;
+            std::string value;
+            if (i < s.size() && s[i] == '"') {
+                if (!readString(value)) return false;
+            } else {
+                while (i < s.size() && s[i] != ',' && s[i] != '}') i++;
+                value = trim(s.substr(start, i - start));
+            }
+            values[key] = value;
+            raw[key] = trim(s.substr(start, i - start));
+
+            skipWs();
+            if (eat(',')) continue;
+            if (eat('}')) return true;
+            return false;
+        }
+    }
+
+private:
+    void skipWs() { while (i < s.size() && (s[i] == ' ' || s[i] == '\t')) i++; }
+    bool eat(char c) { if (i < s.size() && s[i] == c) { i++; return true; } return false; }
+
+    bool readString(std::string& out) {
+        if (!eat('"')) return false;
+        while (i < s.size() && s[i] != '"') {
+            char c = s[i++];
+            if (c == '\\' && i < s.size()) {
+                char e = s[i++];
+                c = (e == 'n') ? '\n' : (e == 't') ? '\t' : e;
+            }
+            out += c;
+        }
+        return eat('"');
+    }
+
+    const std::string& s;
+    size_t i = 0;
+};
+
+} // namespace
+
+BatchSolver::BatchSolver(ThreadPool& pool, const BatchOptions& opts)
+    : pool(pool), opts(opts), cache(kMaxCachedExpressions) {
+    if (this->opts.maxInFlight == 0) this->opts.maxInFlight = 256 * size_t(pool.size());
+}
+
+bool BatchSolver::parseJob(const std::string& rawLine, long lineNo, Job& job, std::string& error) {
+    std::string line = trim(rawLine);
+    job = blankJob(lineNo);
+
+    if (!line.empty() && line[0] == '{') {
+        job.json = true;
+        std::map<std::string, std::string> values, raw;
+        if (!FlatJson(line).parse(values, raw)) { error = "malformed JSON"; return false; }
+
+        if (raw.count("id")) job.id = raw["id"];
+        if (!values.count("f")) { error = "missing \"f\""; return false; }
+        job.expr = values["f"];
+
+        if (values.count("op") && values["op"] == "eval") {
+            job.kind = EVALUATE;
+            if (!values.count("x") || !parseNumber(values["x"], job.x1)) { error = "bad \"x\""; return false; }
+            return true;
+        }
+        if (values.count("op") && values["op"] != "solve") { error = "unknown \"op\""; return false; }
+
+        if (!values.count("x1") || !parseNumber(values["x1"], job.x1)) { error = "bad \"x1\""; return false; }
+        if (!values.count("x2") || !parseNumber(values["x2"], job.x2)) { error = "bad \"x2\""; return false; }
+        if (!values.count("eps") || !parseTolerance(values["eps"], job.eps)) { error = "bad \"eps\""; return false; }
+        if (values.count("max_iter") && !parseIterations(values["max_iter"], job.maxIter)) {
+            error = "bad \"max_iter\"";
+            return false;
+        }
+        if (values.count("method") && !RootSolver::parseMethod(values["method"], job.method)) {
+            error = "unknown \"method\"";
+            return false;
+        }
+        return true;
+    }
+
+    // CSV: the expression itself has no commas, but split from the right anyway
+    size_t c3 = line.rfind(',');
+    size_t c2 = (c3 == std::string::npos || c3 == 0) ? std::string::npos : line.rfind(',', c3 - 1);
+    size_t c1 = (c2 == std::string::npos || c2 == 0) ? std::string::npos : line.rfind(',', c2 - 1);
+
+    if (c3 != std::string::npos && c2 == std::string::npos) {
+        job.kind = EVALUATE;
+        job.expr = trim(line.substr(0, c3));
+        if (!parseNumber(line.substr(c3 + 1), job.x1)) { error = "bad number"; return false; }
+        return true;
+    }
+    if (c1 == std::string::npos) { error = "expected f,x1,x2,eps or f,x"; return false; }
+
+    job.expr = trim(line.substr(0, c1));
+    if (!parseNumber(line.substr(c1 + 1, c2 - c1 - 1), job.x1) ||
+        !parseNumber(line.substr(c2 + 1, c3 - c2 - 1), job.x2) ||
+        !parseTolerance(line.substr(c3 + 1), job.eps)) {
+        error = "bad number";
+        return false;
+    }
+    return true;
+}
+
+BatchSolver::Result BatchSolver::solve(const CompiledExpression& f, const Job& job) {
+    SolveOptions opts;
+    opts.xAbsTol = job.eps;
+    opts.xRelTol = job.eps;
+    opts.maxIter = job.maxIter;
+
+    RootSolver solver(f, job.method, job.x1, job.x2, opts);
+    RootSolver::Status status = solver.solve();
+
+    const char* name = "no_convergence";
+    switch (status) {
+    case RootSolver::CONVERGED:  name = "ok"; break;
+    case RootSolver::DIVERGED:   name = "diverged"; break;
+    case RootSolver::NOT_FINITE: name = "not_finite"; break;
+    case RootSolver::SINGULAR:   name = "singular"; break;
+    default: break;
+    }
+    return {name, solver.root(), solver.value(), solver.iterations(), solver.evaluations()};
+}
+
+BatchSolver::Result BatchSolver::evaluate(const CompiledExpression& f, const Job& job) {
+    double derivative;
+    double value = f.evaluate(job.x1, derivative);
+    return {"ok", value, derivative, 0, 1};
+}
+
+std::string BatchSolver::format(const Job& job, const Result& r) {
+    if (job.kind == EVALUATE && r.status == "ok") {
+        if (job.json) {
+            return "{\"id\": " + (job.id.empty() ? std::to_string(job.line) : job.id) +
+                   ", \"status\": \"ok\", \"value\": " + jsonNumber(r.root) +
+                   ", \"derivative\": " + jsonNumber(r.froot) + "}";
+        }
+        char nums[64];
+        std::snprintf(nums, sizeof nums, "%.17g,%.17g", r.root, r.froot);
+        return std::to_string(job.line) + ",ok," + nums;
+    }
+
+    if (job.json) {
+        return "{\"id\": " + (job.id.empty() ? std::to_string(job.line) : job.id) +
+               ", \"status\": \"" + jsonEscape(r.status) + "\"" +
+               ", \"root\": " + jsonNumber(r.root) +
+               ", \"froot\": " + jsonNumber(r.froot) +
+               ", \"iterations\": " + std::to_string(r.iterations) +
+               ", \"evaluations\": " + std::to_string(r.evaluations) + "}";
+    }
+
+    char nums[96];
+    std::snprintf(nums, sizeof nums, "%.17g,%.17g,%d,%d", r.root, r.froot, r.iterations, r.evaluations);
+    std::string status = r.status;
+    for (char& c : status) if (c == ',') c = ';';
+    return std::to_string(job.line) + "," + status + "," + nums;
+}
+
+long BatchSolver::run(std::istream& in, std::ostream& out) {
+    std::mutex outMutex;
+    std::mutex flightMutex;
+    std::condition_variable slotFree;
+    size_t inFlight = 0;
+
+    long jobs = 0;
+    long lineNo = 0;
+    std::string line;
+    bool tooLong;
+
+    // Called with flightMutex held; outMutex is always taken second
+    auto flushIfIdle = [&] {
+        if (inFlight > 0) return;
+        std::lock_guard<std::mutex> lock(outMutex);
+        out.flush();
+    };
+
+    while (readLine(in, line, opts.maxLineBytes, tooLong)) {
+        lineNo++;
+        std::string t = trim(line);
+        if (t.empty() || t[0] == '#') continue;
+
+        Job job;
+        std::string error;
+        bool ok = false;
+        if (tooLong) {
+            // Only the start of the line was kept, enough to answer in kind
+            job = blankJob(lineNo);
+            job.json = t[0] == '{';
+            error = "line longer than " + std::to_string(opts.maxLineBytes) + " bytes";
+        } else if (parseJob(t, lineNo, job, error)) {
+            ok = job.expr.size() <= opts.maxExprBytes;
+            if (!ok) error = "expression longer than " + std::to_string(opts.maxExprBytes) + " bytes";
+        }
+        if (!ok) {
+            std::string s = format(job, Result{"error: " + error, NAN, NAN, 0, 0});
+            {
+                std::lock_guard<std::mutex> lock(outMutex);
+                out << s << '\n';
+            }
+            std::lock_guard<std::mutex> lock(flightMutex);
+            flushIfIdle();
+            continue;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(flightMutex);
+            slotFree.wait(lock, [&] { return inFlight < opts.maxInFlight; });
+            inFlight++;
+        }
+
+        pool.submit([this, job, &out, &outMutex, &flightMutex, &slotFree, &inFlight, &flushIfIdle] {
+            Result r;
+            try {
+                SharedExpression f = cache.get(job.expr);
+                r = (job.kind == EVALUATE) ? evaluate(*f, job) : solve(*f, job);
+            } catch (const std::exception& e) {
+                r = {std::string("error: ") + e.what(), NAN, NAN, 0, 0};
+            }
+
+            std::string s = format(job, r);
+            {
+                std::lock_guard<std::mutex> lock(outMutex);
+                out << s << '\n';
+            }
+            // Notified under the lock: once run() sees inFlight == 0 it
+            // returns, and slotFree goes with it
+            std::lock_guard<std::mutex> lock(flightMutex);
+            inFlight--;
+            flushIfIdle();
+            slotFree.notify_one();
+        });
+        jobs++;
+    }
+
+    // Only this call's jobs: other callers may be using the pool too
+    std::unique_lock<std::mutex> lock(flightMutex);
+    slotFree.wait(lock, [&] { return inFlight == 0; });
+    return jobs;
+}
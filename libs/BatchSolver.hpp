@@ -0,0 +1,88 @@
+#pragma once
+
+#include <iosfwd>
+#include <string>
+#include "CompiledExpression.hpp"
+#include "ExpressionCache.hpp"
+#include "Solvers.hpp"
+#include "ThreadPool.hpp"
+
+struct BatchOptions {
+    size_t maxInFlight = 0;         // jobs queued or running at once; 0: 256 per pool thread
+    size_t maxLineBytes = 1 << 16;  // longer lines are skipped, not read into memory
+    size_t maxExprBytes = 1 << 14;  // longer expressions are not parsed
+};
+
+// Non-interactive root solving of many jobs read one per line.
+//
+// Input lines are either CSV       f(x),x1,x2,eps
+//                 or JSON objects  {"id": ..., "f": "...", "x1": 0, "x2": 1, "eps": 1e-6}
+// JSON jobs may also give "max_iter" (a whole number from 1 to 100000,
+// default 100) and "method" (a RootSolver method name: secant, brent,
+// illinois, anderson-bjorck or steffensen); the default, and the method for
+// CSV jobs, is brent. eps, finite and not negative, is the absolute and
+// relative tolerance on x. Blank lines and lines starting with '#' are skipped. Each
+// result is written as soon as its job finishes, in the same format as its
+// input line:
+//   CSV:  line,status,root,f(root),iterations,evaluations
+//   JSON: {"id": ..., "status": "...", "root": ..., "froot": ..., "iterations": ..., "evaluations": ...}
+// status is ok, no_convergence, diverged, not_finite, singular (the bracket
+// closed on a pole) or error: <message>. A line longer than maxLineBytes, or
+// a job whose expression is longer than maxExprBytes, is answered with an
+// error like any other bad line (the id of an over-long JSON line is lost:
+// it is answered by line number).
+//
+// A job may instead evaluate f and f' at one point:
+//   CSV:  f(x),x                                 -> line,ok,f(x),f'(x)
+//   JSON: {"op": "eval", "f": "...", "x": 0.5}   -> {"id": ..., "status": "ok", "value": ..., "derivative": ...}
+//
+// Jobs run on a thread pool with a bounded number in flight, so memory stays
+// flat however long the input is. Jobs with the same f(x) share one parse,
+// across runs as well: run() may be called from several threads at once
+// (SolverServer does, once per connection), and the calls share the pool
+// and the cache. Output is flushed whenever every job read so far has been
+// answered, so a client waiting on its answers gets them.
+class BatchSolver {
+public:
+    enum Kind {
+        SOLVE,
+        EVALUATE // f and f' at x1
+    };
+
+    struct Job {
+        long line;
+        std::string id; // raw JSON value of "id", empty for CSV
+        bool json;
+        std::string expr;
+        double x1, x2, eps;
+        int maxIter;
+        RootSolver::Method method;
+        Kind kind;
+    };
+
+    struct Result {
+        std::string status;
+        double root, froot; // f(x1) and f'(x1) for EVALUATE
+        int iterations, evaluations;
+    };
+
+    explicit BatchSolver(ThreadPool& pool, const BatchOptions& opts = BatchOptions());
+
+    // Reads jobs until EOF and returns the number of jobs processed.
+    long run(std::istream& in, std::ostream& out);
+
+    // Parses one input line. Returns false, with a message in error, if the
+    // line is malformed.
+    static bool parseJob(const std::string& line, long lineNo, Job& job, std::string& error);
+
+    static Result solve(const CompiledExpression& f, const Job& job);
+    static Result evaluate(const CompiledExpression& f, const Job& job);
+    static std::string format(const Job& job, const Result& r);
+
+    const ExpressionCache& expressions() const { return cache; }
+
+private:
+    ThreadPool& pool;
+    BatchOptions opts;
+    ExpressionCache cache;
+};
@@ -0,0 +1,347 @@
+#include "CompiledExpression.hpp"
+#include "Horner.hpp"
+#include "Instrument.hpp"
+#include "VecMath.hpp"
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Points per block in batch evaluation. Each stack slot becomes a row of this
+// many doubles, so a typical program's working set stays in L1.
+const size_t kBatchLanes = 128;
+
+} // namespace
+
+int CompiledExpression::arity(OpCode op) {
+    switch (op) {
+        case OP_CONST:
+        case OP_VAR:
+        case OP_DUP:
+        case OP_LOAD:
+        case OP_PARAM:
+            return 0;
+        case OP_STORE:
+            return 1;
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_POW:
+            return 2;
+        default:
+            return 1;
+    }
+}
+
+int CompiledExpression::parameterIndex(const std::string& name) const {
+    for (size_t i = 0; i < paramNames.size(); ++i)
+        if (paramNames[i] == name) return int(i);
+    return -1;
+}
+
+double CompiledExpression::operator()(double xValue) const {
+    if (code.empty()) return NAN;
+    INSTR_COUNT(EVALUATIONS, 1);
+    if (!poly.empty()) return horner(poly.data(), int(poly.size()) - 1, xValue);
+    if (native) return native(xValue, paramValues.data());
+    INSTR_COUNT(RPN_OPS, code.size());
+
+    double st[kMaxStack];
+    double slots[kMaxSlots];
+    double* top = st - 1; // points at the current top of stack
+
+    for (const Instr& in : code) {
+        switch (in.op) {
+            case OP_CONST: *++top = in.imm;  break;
+            case OP_VAR:   *++top = xValue;  break;
+            case OP_DUP:   top[1] = top[0]; ++top; break;
+            case OP_STORE: slots[in.arg] = *top; break;
+            case OP_LOAD:  *++top = slots[in.arg]; break;
+            case OP_PARAM: *++top = paramValues[in.arg]; break;
+
+            case OP_ADD: top[-1] += top[0]; --top; break;
+            case OP_SUB: top[-1] -= top[0]; --top; break;
+            case OP_MUL: top[-1] *= top[0]; --top; break;
+            case OP_DIV: top[-1] /= top[0]; --top; break;
+            case OP_POW: top[-1] = std::pow(top[-1], top[0]); --top; break;
+
+            case OP_SIN: *top = std::sin(*top); break;
+            case OP_COS: *top = std::cos(*top); break;
+            case OP_TAN: *top = std::tan(*top); break;
+            case OP_EXP: *top = std::exp(*top); break;
+            case OP_LOG: *top = std::log(*top); break;
+        }
+    }
+
+    return *top;
+}
+
+double CompiledExpression::evaluate(double xValue, double& derivative) const {
+    if (code.empty()) {
+        derivative = NAN;
+        return NAN;
+    }
+    INSTR_COUNT(EVALUATIONS, 1);
+    if (!poly.empty()) return horner_derivative(poly.data(), int(poly.size()) - 1, xValue, derivative);
+    INSTR_COUNT(RPN_OPS, code.size());
+
+    // Dual numbers: v is the value, d its derivative with respect to x
+    struct Dual { double v, d; };
+    Dual st[kMaxStack];
+    Dual slots[kMaxSlots];
+    Dual* top = st - 1;
+
+    for (const Instr& in : code) {
+        switch (in.op) {
+            case OP_CONST: *++top = {in.imm, 0.0};  break;
+            case OP_VAR:   *++top = {xValue, 1.0};  break;
+            case OP_DUP:   top[1] = top[0]; ++top; break;
+            case OP_STORE: slots[in.arg] = *top; break;
+            case OP_LOAD:  *++top = slots[in.arg]; break;
+            case OP_PARAM: *++top = {paramValues[in.arg], 0.0}; break;
+
+            case OP_ADD: --top; *top = {top[0].v + top[1].v, top[0].d + top[1].d}; break;
+            case OP_SUB: --top; *top = {top[0].v - top[1].v, top[0].d - top[1].d}; break;
+            case OP_MUL: {
+                Dual a = top[-1], b = top[0];
+                *--top = {a.v * b.v, a.d * b.v + a.v * b.d};
+                break;
+            }
+            case OP_DIV: {
+                Dual a = top[-1], b = top[0];
+                double q = a.v / b.v;
+                *--top = {q, (a.d - q * b.d) / b.v};
+                break;
+            }
+            case OP_POW: {
+                Dual a = top[-1], b = top[0];
+                double p = std::pow(a.v, b.v);
+                double d;
+                if (b.d == 0.0) // constant exponent: b * a^(b-1) * a'
+                    d = (a.d == 0.0) ? 0.0 : b.v * std::pow(a.v, b.v - 1.0) * a.d;
+                else            // general case: a^b * (b' ln a + b a'/a)
+                    d = p * (b.d * std::log(a.v) + b.v * a.d / a.v);
+                *--top = {p, d};
+                break;
+            }
+
+            case OP_SIN: *top = {std::sin(top->v), std::cos(top->v) * top->d}; break;
+            case OP_COS: *top = {std::cos(top->v), -std::sin(top->v) * top->d}; break;
+            case OP_TAN: {
+                double t = std::tan(top->v);
+                *top = {t, (1.0 + t * t) * top->d};
+                break;
+            }
+            case OP_EXP: {
+                double e = std::exp(top->v);
+                *top = {e, e * top->d};
+                break;
+            }
+            case OP_LOG: *top = {std::log(top->v), top->d / top->v}; break;
+        }
+    }
+
+    derivative = top->d;
+    return top->v;
+}
+
+void CompiledExpression::evaluate(const double* xs, double* out, size_t n) const {
+    if (code.empty()) {
+        for (size_t i = 0; i < n; ++i) out[i] = NAN;
+        return;
+    }
+    INSTR_COUNT(EVALUATIONS, n);
+    if (!poly.empty()) {
+        horner_points(poly.data(), int(poly.size()) - 1, xs, out, n);
+        return;
+    }
+    INSTR_COUNT(RPN_OPS, code.size() * n);
+
+    const size_t B = kBatchLanes;
+    std::vector<double> rows(size_t(maxDepth) * B);
+    std::vector<double> slotRows(size_t(numSlots) * B);
+
+    for (size_t base = 0; base < n; base += B) {
+        const size_t m = (n - base < B) ? n - base : B;
+        const double* x = xs + base;
+        double* top = rows.data() - B; // row of the current top of stack
+
+        for (const Instr& in : code) {
+            double* below = top - B;
+
+            switch (in.op) {
+                case OP_CONST:
+                    top += B;
+                    for (size_t i = 0; i < m; ++i) top[i] = in.imm;
+                    break;
+                case OP_VAR:
+                    top += B;
+                    std::memcpy(top, x, m * sizeof(double));
+                    break;
+                case OP_DUP:
+                    std::memcpy(top + B, top, m * sizeof(double));
+                    top += B;
+                    break;
+                case OP_STORE:
+                    std::memcpy(&slotRows[size_t(in.arg) * B], top, m * sizeof(double));
+                    break;
+                case OP_LOAD:
+                    top += B;
+                    std::memcpy(top, &slotRows[size_t(in.arg) * B], m * sizeof(double));
+                    break;
+                case OP_PARAM: {
+                    double v = paramValues[in.arg];
+                    top += B;
+                    for (size_t i = 0; i < m; ++i) top[i] = v;
+                    break;
+                }
+
+                case OP_ADD: for (size_t i = 0; i < m; ++i) below[i] += top[i]; top = below; break;
+                case OP_SUB: for (size_t i = 0; i < m; ++i) below[i] -= top[i]; top = below; break;
+                case OP_MUL: for (size_t i = 0; i < m; ++i) below[i] *= top[i]; top = below; break;
+                case OP_DIV: for (size_t i = 0; i < m; ++i) below[i] /= top[i]; top = below; break;
+                case OP_POW: vec_pow(below, top, below, m); top = below; break;
+
+                case OP_SIN: vec_sin(top, top, m); break;
+                case OP_COS: vec_cos(top, top, m); break;
+                case OP_TAN: for (size_t i = 0; i < m; ++i) top[i] = std::tan(top[i]); break;
+                case OP_EXP: vec_exp(top, top, m); break;
+                case OP_LOG: vec_log(top, top, m); break;
+            }
+        }
+
+        std::memcpy(out + base, top, m * sizeof(double));
+    }
+}
+
+Interval CompiledExpression::evaluate(const Interval& x) const {
+    if (code.empty()) return Interval::empty();
+    INSTR_COUNT(EVALUATIONS, 1);
+    INSTR_COUNT(RPN_OPS, code.size());
+
+    // Runs the program even for polynomials: Horner's rule on intervals is
+    // no tighter than the terms as written
+    Interval st[kMaxStack];
+    Interval slots[kMaxSlots];
+    Interval* top = st - 1;
+    OpCode prev = OP_CONST;
+
+    for (const Instr& in : code) {
+        switch (in.op) {
+            case OP_CONST: *++top = Interval(in.imm); break;
+            case OP_VAR:   *++top = x; break;
+            case OP_DUP:   top[1] = top[0]; ++top; break;
+            case OP_STORE: slots[in.arg] = *top; break;
+            case OP_LOAD:  *++top = slots[in.arg]; break;
+            case OP_PARAM: *++top = Interval(paramValues[in.arg]); break;
+
+            case OP_ADD: --top; *top = top[0] + top[1]; break;
+            case OP_SUB: --top; *top = top[0] - top[1]; break;
+            case OP_DIV: --top; *top = top[0] / top[1]; break;
+            case OP_POW: --top; *top = pow(top[0], top[1]); break;
+
+            // The optimizer writes x^2 as DUP MUL; squaring keeps it >= 0
+            case OP_MUL:
+                --top;
+                *top = (prev == OP_DUP) ? pow(top[0], Interval(2.0)) : top[0] * top[1];
+                break;
+
+            case OP_SIN: *top = sin(*top); break;
+            case OP_COS: *top = cos(*top); break;
+            case OP_TAN: *top = tan(*top); break;
+            case OP_EXP: *top = exp(*top); break;
+            case OP_LOG: *top = log(*top); break;
+        }
+        prev = in.op;
+    }
+
+    return *top;
+}
+
+Interval CompiledExpression::evaluate(const Interval& x, Interval& derivative) const {
+    if (code.empty()) {
+        derivative = Interval::empty();
+        return Interval::empty();
+    }
+    INSTR_COUNT(EVALUATIONS, 1);
+    INSTR_COUNT(RPN_OPS, code.size());
+
+    struct Dual { Interval v, d; };
+    Dual st[kMaxStack];
+    Dual slots[kMaxSlots];
+    Dual* top = st - 1;
+    OpCode prev = OP_CONST;
+
+    // Whether f is defined on all of x. Where it is not, f may be monotonic
+    // on each piece it is defined on and still jump between them, so the
+    // derivative proves nothing
+    bool total = true;
+
+    for (const Instr& in : code) {
+        switch (in.op) {
+            case OP_CONST: *++top = {Interval(in.imm), Interval(0.0)}; break;
+            case OP_VAR:   *++top = {x, Interval(1.0)}; break;
+            case OP_DUP:   top[1] = top[0]; ++top; break;
+            case OP_STORE: slots[in.arg] = *top; break;
+            case OP_LOAD:  *++top = slots[in.arg]; break;
+            case OP_PARAM: *++top = {Interval(paramValues[in.arg]), Interval(0.0)}; break;
+
+            case OP_ADD: --top; *top = {top[0].v + top[1].v, top[0].d + top[1].d}; break;
+            case OP_SUB: --top; *top = {top[0].v - top[1].v, top[0].d - top[1].d}; break;
+            case OP_MUL: {
+                Dual a = top[-1], b = top[0];
+                Interval v = (prev == OP_DUP) ? pow(a.v, Interval(2.0)) : a.v * b.v;
+                *--top = {v, a.d * b.v + a.v * b.d};
+                break;
+            }
+            case OP_DIV: {
+                Dual a = top[-1], b = top[0];
+                Interval q = a.v / b.v;
+                if (b.v.contains(0.0)) total = false;
+                *--top = {q, (a.d - q * b.d) / b.v};
+                break;
+            }
+            case OP_POW: {
+                Dual a = top[-1], b = top[0];
+                Interval p = pow(a.v, b.v);
+                Interval d;
+                bool integer = b.v.lo == b.v.hi && b.v.lo == std::floor(b.v.lo);
+                if (integer ? (b.v.lo < 0.0 && a.v.contains(0.0)) : !(a.v.lo > 0.0)) total = false;
+                if (b.d.lo == 0.0 && b.d.hi == 0.0) {
+                    // constant exponent: b * a^(b-1) * a'. A point b keeps
+                    // b - 1 a point, so x^3 still knows 2 is an integer
+                    Interval e = b.v - Interval(1.0);
+                    if (b.v.lo == b.v.hi && (b.v.lo - 1.0) + 1.0 == b.v.lo) e = Interval(b.v.lo - 1.0);
+                    d = b.v * pow(a.v, e) * a.d;
+                } else {
+                    d = p * (b.d * log(a.v) + b.v * a.d / a.v);
+                }
+                *--top = {p, d};
+                break;
+            }
+
+            case OP_SIN: *top = {sin(top->v), cos(top->v) * top->d}; break;
+            case OP_COS: *top = {cos(top->v), Interval(0.0) - sin(top->v) * top->d}; break;
+            case OP_TAN: {
+                Interval t = tan(top->v);
+                if (!std::isfinite(t.lo) || !std::isfinite(t.hi)) total = false; // a pole
+                *top = {t, (Interval(1.0) + pow(t, Interval(2.0))) * top->d};
+                break;
+            }
+            case OP_EXP: {
+                Interval e = exp(top->v);
+                *top = {e, e * top->d};
+                break;
+            }
+            case OP_LOG:
+                if (!(top->v.lo > 0.0)) total = false;
+                *top = {log(top->v), top->d / top->v};
+                break;
+        }
+        prev = in.op;
+    }
+
+    derivative = total ? top->d : Interval::entire();
+    return top->v;
+}
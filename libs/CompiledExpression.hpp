@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Interval.hpp"
+
+class JitCode;
+
+// A parsed f(x) lowered to a flat stack-machine program.
+// Build one with MathParser::compile and call it like a function.
+// Evaluation never modifies the object, so one instance may be evaluated by
+// any number of threads at once. Setting a parameter does modify it: code
+// that varies parameters from several threads gives each its own copy.
+class CompiledExpression {
+public:
+    enum OpCode : unsigned char {
+        OP_CONST,   // push imm
+        OP_VAR,     // push x
+        OP_DUP,     // push a copy of the top
+        OP_STORE,   // copy the top into slot[arg], leaving it on the stack
+        OP_LOAD,    // push slot[arg]
+        OP_PARAM,   // push parameter[arg]
+        OP_ADD,
+        OP_SUB,
+        OP_MUL,
+        OP_DIV,
+        OP_POW,
+        OP_SIN,
+        OP_COS,
+        OP_TAN,
+        OP_EXP,
+        OP_LOG
+    };
+
+    struct Instr {
+        OpCode op;
+        int arg;    // slot index for OP_STORE / OP_LOAD, parameter for OP_PARAM
+        double imm; // only used by OP_CONST
+    };
+
+    // Size of the value stack the evaluator keeps on the C++ stack.
+    // MathParser::compile rejects programs that would need more.
+    static const int kMaxStack = 64;
+
+    // Number of slots available for values shared between subexpressions.
+    static const int kMaxSlots = 32;
+
+    CompiledExpression() = default;
+
+    // Number of stack operands consumed by op.
+    static int arity(OpCode op);
+
+    double operator()(double xValue) const;
+
+    // Returns f(x) and stores f'(x) in derivative, both from one forward-mode
+    // pass that carries (value, derivative) pairs through the program.
+    double evaluate(double xValue, double& derivative) const;
+
+    // Evaluates f at n points: out[i] = f(xs[i]). Runs each opcode across a
+    // block of points at a time so the arithmetic vectorizes; sin, cos, exp,
+    // log and ^ use the kernels in VecMath.hpp.
+    void evaluate(const double* xs, double* out, size_t n) const;
+
+    // Encloses f over every x in the interval: the result contains f(x) for
+    // all of them (see Interval.hpp for the rounding). It is usually wider
+    // than the true range, since each occurrence of x varies on its own, but
+    // it narrows as x does. Empty when f is undefined on all of x.
+    Interval evaluate(const Interval& x) const;
+
+    // The same enclosure of f, plus one of f' over x in derivative, from one
+    // forward-mode pass as in evaluate(double, double&). A derivative that
+    // excludes zero proves f monotonic on x; it is [-inf, inf] wherever f
+    // may be undefined on part of x (a division by an interval around
+    // zero, log of one reaching zero), since f can jump there.
+    Interval evaluate(const Interval& x, Interval& derivative) const;
+
+    const std::vector<Instr>& program() const { return code; }
+    int stackDepth() const { return maxDepth; }
+    int slotCount() const { return numSlots; }
+
+    // When f is a polynomial in x written as a sum of terms c x^k (see
+    // ExprGraph::polynomial), its coefficients, highest degree first, and
+    // all three evaluators use Horner's rule on them instead of running the
+    // program. Empty otherwise.
+    const std::vector<double>& coefficients() const { return poly; }
+    bool isPolynomial() const { return !poly.empty(); }
+
+    // Named parameters, in the order given to MathParser::compile. Their
+    // values are read at every evaluation, so a parameter can change
+    // between solves without compiling again (an EvalMemo made before the
+    // change is stale after it). All start out as NaN.
+    const std::vector<std::string>& parameters() const { return paramNames; }
+    int parameterIndex(const std::string& name) const; // -1 if there is none
+    double parameter(int index) const { return paramValues[index]; }
+    void setParameter(int index, double value) { paramValues[index] = value; }
+
+    // Whether operator() runs native code from the JIT (see Jit.hpp) rather
+    // than the interpreter. The batch, derivative and interval evaluators
+    // always interpret.
+    bool isNative() const { return native != nullptr; }
+
+private:
+    friend class MathParser;
+    friend class ExprGraph;
+
+    std::vector<Instr> code;
+    int maxDepth = 0;
+    int numSlots = 0;
+    std::vector<double> poly;
+    std::vector<std::string> paramNames;
+    std::vector<double> paramValues;
+    double (*native)(double, const double*) = nullptr;
+    std::shared_ptr<const JitCode> nativeCode; // keeps native's code mapped
+};
+
+// Immutable, reference-counted handle to a compiled expression. Cheap to
+// copy between threads; see ExpressionCache for getting one.
+typedef std::shared_ptr<const CompiledExpression> SharedExpression;
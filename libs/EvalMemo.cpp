@@ -0,0 +1,50 @@
+#include "EvalMemo.hpp"
+#include <cstring>
+
+namespace {
+
+// Slots tried before the home slot is overwritten.
+const size_t kMaxProbe = 4;
+
+} // namespace
+
+EvalMemo::EvalMemo(const CompiledExpression& f, size_t capacity) : f(f) {
+    size_t n = 8;
+    while (n < capacity) n *= 2;
+    slots.assign(n, Slot{0, 0.0, false});
+    mask = n - 1;
+}
+
+double EvalMemo::operator()(double x, bool& evaluated) {
+    uint64_t key;
+    std::memcpy(&key, &x, sizeof key);
+
+    // Fibonacci hashing; the top bits mix all of the mantissa
+    size_t home = size_t((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+    lookupCount++;
+
+    for (size_t i = 0; i < kMaxProbe; ++i) {
+        Slot& s = slots[(home + i) & mask];
+        if (!s.used) {
+            evaluated = true;
+            s = {key, f(x), true};
+            return s.value;
+        }
+        if (s.key == key) {
+            hitCount++;
+            evaluated = false;
+            return s.value;
+        }
+    }
+
+    evaluated = true;
+    Slot& s = slots[home];
+    s = {key, f(x), true};
+    return s.value;
+}
+
+void EvalMemo::clear() {
+    for (Slot& s : slots) s.used = false;
+    lookupCount = 0;
+    hitCount = 0;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "CompiledExpression.hpp"
+
+// Small memo table of f(x) values for one compiled expression, keyed by the
+// bit pattern of x. Solvers that revisit points (restarts, shared bracket
+// ends, re-running the same solve) get those values without evaluating f.
+//
+// Open addressing with a short linear probe; when every probed slot is taken
+// the home slot is overwritten, so the table never grows. Not thread-safe:
+// give each thread its own memo.
+class EvalMemo {
+public:
+    // capacity is rounded up to a power of two.
+    explicit EvalMemo(const CompiledExpression& f, size_t capacity = 256);
+
+    // Returns f(x). Sets evaluated to whether f actually had to be run.
+    double operator()(double x, bool& evaluated);
+
+    void clear();
+
+    const CompiledExpression& function() const { return f; }
+    uint64_t lookups() const { return lookupCount; }
+    uint64_t hits() const { return hitCount; }
+    double hitRate() const { return lookupCount ? double(hitCount) / double(lookupCount) : 0.0; }
+
+private:
+    struct Slot {
+        uint64_t key;
+        double value;
+        bool used;
+    };
+
+    const CompiledExpression& f;
+    std::vector<Slot> slots;
+    size_t mask;
+    uint64_t lookupCount = 0;
+    uint64_t hitCount = 0;
+};
@@ -0,0 +1,424 @@
+#include "ExprGraph.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+typedef CompiledExpression CE;
+
+namespace {
+
+double apply(CE::OpCode op, double a, double b) {
+    switch (op) {
+        case CE::OP_ADD: return a + b;
+        case CE::OP_SUB: return a - b;
+        case CE::OP_MUL: return a * b;
+        case CE::OP_DIV: return a / b;
+        case CE::OP_POW: return std::pow(a, b);
+        case CE::OP_SIN: return std::sin(a);
+        case CE::OP_COS: return std::cos(a);
+        case CE::OP_TAN: return std::tan(a);
+        case CE::OP_EXP: return std::exp(a);
+        case CE::OP_LOG: return std::log(a);
+        default:         return NAN;
+    }
+}
+
+// Integer exponents whose power is cheaper as a few multiplications.
+bool isSmallIntPower(double e) {
+    return e == std::floor(e) && std::fabs(e) >= 2.0 && std::fabs(e) <= 4.0;
+}
+
+uint64_t bitsOf(double v) {
+    uint64_t bits;
+    std::memcpy(&bits, &v, sizeof bits);
+    return bits;
+}
+
+// a+b and b+a (and a*b, b*a) are one node. Only the lookup treats them as
+// equal; a node keeps the operand order it was created with, so left-deep
+// input stays left-deep.
+bool commutes(CE::OpCode op) {
+    return op == CE::OP_ADD || op == CE::OP_MUL;
+}
+
+size_t hashNode(CE::OpCode op, uint64_t bits, int lhs, int rhs) {
+    if (commutes(op) && lhs > rhs) std::swap(lhs, rhs);
+    uint64_t h = bits ^ (uint64_t(op) << 58) ^ (uint64_t(uint32_t(lhs)) << 29) ^ uint32_t(rhs);
+    h ^= h >> 31;
+    h *= 0x9E3779B97F4A7C15ull;
+    h ^= h >> 29;
+    return size_t(h);
+}
+
+const size_t kMinBuckets = 64;
+
+// Highest degree polynomial() expands, and how many Horner steps one program
+// instruction is worth when deciding whether to use the coefficients.
+const int kMaxPolyDegree = 64;
+const int kHornerStepsPerInstr = 4;
+
+} // namespace
+
+void ExprGraph::build(const std::vector<Instr>& code) {
+    pool.clear();
+    if (index.size() < kMinBuckets) index.resize(kMinBuckets);
+    std::fill(index.begin(), index.end(), -1);
+
+    std::vector<int>& st = stack;
+    st.clear();
+    slotNode.assign(CE::kMaxSlots, -1);
+
+    for (const Instr& in : code) {
+        switch (in.op) {
+            case CE::OP_CONST: st.push_back(constant(in.imm)); continue;
+            case CE::OP_DUP:   st.push_back(st.back()); continue;
+            case CE::OP_STORE: slotNode[in.arg] = st.back(); continue;
+            case CE::OP_LOAD:  st.push_back(slotNode[in.arg]); continue;
+            case CE::OP_PARAM: st.push_back(intern(CE::OP_PARAM, in.arg, -1, -1)); continue;
+            default: break;
+        }
+
+        switch (CE::arity(in.op)) {
+            case 0:
+                st.push_back(make(in.op, -1, -1));
+                break;
+            case 1:
+                st.back() = make(in.op, st.back(), -1);
+                break;
+            default: {
+                int b = st.back(); st.pop_back();
+                st.back() = make(in.op, st.back(), b);
+                break;
+            }
+        }
+    }
+
+    if (st.size() != 1)
+        throw std::runtime_error("Malformed expression");
+    rootId = st.back();
+}
+
+int ExprGraph::constant(double v) {
+    return intern(CE::OP_CONST, v, -1, -1);
+}
+
+// Returns the existing node equal to (op, value, lhs, rhs), creating it if
+// this is the first time it is seen.
+int ExprGraph::intern(OpCode op, double value, int lhs, int rhs) {
+    uint64_t bits = bitsOf(value);
+    size_t mask = index.size() - 1;
+
+    size_t b = hashNode(op, bits, lhs, rhs) & mask;
+    for (; index[b] >= 0; b = (b + 1) & mask) {
+        const Node& nd = pool[index[b]];
+        if (nd.op != op || bitsOf(nd.value) != bits) continue;
+        if ((nd.lhs == lhs && nd.rhs == rhs) || (commutes(op) && nd.lhs == rhs && nd.rhs == lhs))
+            return index[b];
+    }
+
+    pool.push_back({op, value, lhs, rhs});
+    int id = int(pool.size()) - 1;
+    index[b] = id;
+
+    // Keep the table at most half full
+    if (pool.size() * 2 > index.size()) rehash(index.size() * 2);
+    return id;
+}
+
+void ExprGraph::rehash(size_t buckets) {
+    index.assign(buckets, -1);
+    size_t mask = buckets - 1;
+
+    for (size_t id = 0; id < pool.size(); ++id) {
+        const Node& nd = pool[id];
+        size_t b = hashNode(nd.op, bitsOf(nd.value), nd.lhs, nd.rhs) & mask;
+        while (index[b] >= 0) b = (b + 1) & mask;
+        index[b] = int(id);
+    }
+}
+
+bool ExprGraph::isConst(int id) const {
+    return pool[id].op == CE::OP_CONST;
+}
+
+bool ExprGraph::isConst(int id, double v) const {
+    return isConst(id) && pool[id].value == v;
+}
+
+int ExprGraph::make(OpCode op, int lhs, int rhs) {
+    int n = CE::arity(op);
+
+    // Fold operations whose operands are all known
+    if (n == 1 && isConst(lhs))
+        return constant(apply(op, pool[lhs].value, 0.0));
+    if (n == 2 && isConst(lhs) && isConst(rhs))
+        return constant(apply(op, pool[lhs].value, pool[rhs].value));
+
+    switch (op) {
+        case CE::OP_ADD:
+            if (isConst(rhs, 0.0)) return lhs;
+            if (isConst(lhs, 0.0)) return rhs;
+            break;
+        case CE::OP_SUB:
+            if (isConst(rhs, 0.0)) return lhs;
+            break;
+        case CE::OP_MUL:
+            if (isConst(rhs, 1.0)) return lhs;
+            if (isConst(lhs, 1.0)) return rhs;
+            break;
+        case CE::OP_DIV:
+            if (isConst(rhs, 1.0)) return lhs;
+            if (isConst(rhs)) {
+                // a / c  ->  a * (1/c), unless 1/c over- or underflows
+                double inv = 1.0 / pool[rhs].value;
+                if (std::isnormal(inv)) return make(CE::OP_MUL, lhs, constant(inv));
+            }
+            break;
+        case CE::OP_POW:
+            if (isConst(rhs, 1.0)) return lhs;
+            if (isConst(rhs, 0.0)) return constant(1.0);
+            break;
+        default:
+            break;
+    }
+
+    return intern(op, 0.0, lhs, rhs);
+}
+
+int ExprGraph::emit(std::vector<Instr>& out, int& slotCount) {
+    out.clear();
+
+    EmitState es;
+    es.out = &out;
+    uses.assign(pool.size(), 0);
+    slotOf.assign(pool.size(), -1);
+    countNeed();
+    uses[rootId] = 1;
+    countUses(rootId);
+
+    emitNode(rootId, es);
+
+    if (es.maxDepth > CE::kMaxStack)
+        throw std::runtime_error("Expression is nested too deeply");
+    slotCount = es.slots;
+    return es.maxDepth;
+}
+
+// Stack slots each node takes to evaluate (Sethi-Ullman numbers), ignoring
+// slots: the operand that needs more goes first where the operation allows
+// it, so a long sum needs two slots however it was parenthesized.
+void ExprGraph::countNeed() {
+    need.resize(pool.size());
+    // Operands always have smaller ids than the nodes using them
+    for (size_t id = 0; id < pool.size(); ++id) {
+        const Node& nd = pool[id];
+        int l = nd.lhs >= 0 ? need[nd.lhs] : 0;
+        int r = nd.rhs >= 0 ? need[nd.rhs] : 0;
+        if (nd.lhs < 0) {
+            need[id] = 1;
+        } else if (nd.op == CE::OP_POW && isConst(nd.rhs) && isSmallIntPower(pool[nd.rhs].value)) {
+            double e = pool[nd.rhs].value;
+            need[id] = l + (std::fabs(e) == 3.0 ? 2 : 1) + (e < 0 ? 1 : 0);
+        } else if (nd.rhs < 0) {
+            need[id] = l;
+        } else if (commutes(nd.op)) {
+            need[id] = l == r ? l + 1 : std::max(l, r);
+        } else {
+            need[id] = std::max(l, r + 1);
+        }
+    }
+}
+
+// Counts, for every node reachable from id, how many emitted parents refer to
+// it. A shared parent is emitted once, so its operands are only counted once.
+// Both traversals keep their own stack: a sum of many terms is as deep a
+// tree as it is long, while it needs only two evaluation stack entries.
+void ExprGraph::countUses(int id) {
+    std::vector<int>& todo = stack;
+    todo.assign(1, id);
+    while (!todo.empty()) {
+        const Node& nd = pool[todo.back()];
+        todo.pop_back();
+        for (int child : {nd.lhs, nd.rhs}) {
+            if (child < 0) continue;
+            if (uses[child]++ == 0) todo.push_back(child);
+        }
+    }
+}
+
+void ExprGraph::emitNode(int id, EmitState& es) {
+    auto push = [&](OpCode op, int arg, double imm) {
+        es.out->push_back({op, arg, imm});
+        es.depth += 1 - CE::arity(op);
+        if (es.depth > es.maxDepth) es.maxDepth = es.depth;
+    };
+
+    // Each frame is a node and how many of its operands have been emitted
+    std::vector<EmitFrame>& frames = emitFrames;
+    frames.assign(1, {id, 0});
+
+    while (!frames.empty()) {
+        int cur = frames.back().id;
+        int done = frames.back().operands;
+        const Node& nd = pool[cur];
+        bool power = nd.op == CE::OP_POW && isConst(nd.rhs) && isSmallIntPower(pool[nd.rhs].value);
+
+        if (done == 0 && slotOf[cur] >= 0) {
+            // Right after the store the value is still on top of the stack
+            const Instr& last = es.out->back();
+            if (last.op == CE::OP_STORE && last.arg == slotOf[cur]) push(CE::OP_DUP, 0, 0.0);
+            else push(CE::OP_LOAD, slotOf[cur], 0.0);
+            frames.pop_back();
+            continue;
+        }
+
+        // a+b is emitted as b a + when b needs more of the stack; a small
+        // integer power emits only its base
+        bool swapped = commutes(nd.op) && need[nd.rhs] > need[nd.lhs];
+        int first = swapped ? nd.rhs : nd.lhs, second = swapped ? nd.lhs : nd.rhs;
+        if (power) second = -1;
+
+        if (done == 0 && power && pool[nd.rhs].value < 0) push(CE::OP_CONST, 0, 1.0);
+        if (done < 2) {
+            int next = done == 0 ? first : second;
+            frames.back().operands++;
+            if (next >= 0) frames.push_back({next, 0});
+            continue;
+        }
+        frames.pop_back();
+
+        if (power) {
+            double e = pool[nd.rhs].value;
+            switch (int(std::fabs(e))) {
+                case 2: // b*b
+                    push(CE::OP_DUP, 0, 0.0); push(CE::OP_MUL, 0, 0.0);
+                    break;
+                case 3: // b*b*b
+                    push(CE::OP_DUP, 0, 0.0); push(CE::OP_DUP, 0, 0.0);
+                    push(CE::OP_MUL, 0, 0.0); push(CE::OP_MUL, 0, 0.0);
+                    break;
+                case 4: // (b*b)*(b*b)
+                    push(CE::OP_DUP, 0, 0.0); push(CE::OP_MUL, 0, 0.0);
+                    push(CE::OP_DUP, 0, 0.0); push(CE::OP_MUL, 0, 0.0);
+                    break;
+            }
+            if (e < 0) push(CE::OP_DIV, 0, 0.0);
+        } else {
+            push(nd.op, nd.op == CE::OP_PARAM ? int(nd.value) : 0, nd.value);
+        }
+
+        // Keep shared results for later references; leaves are cheaper to redo.
+        bool leaf = nd.op == CE::OP_CONST || nd.op == CE::OP_VAR || nd.op == CE::OP_PARAM;
+        if (!leaf && uses[cur] > 1 && es.slots < CE::kMaxSlots) {
+            slotOf[cur] = es.slots++;
+            push(CE::OP_STORE, slotOf[cur], 0.0);
+        }
+    }
+}
+
+bool ExprGraph::polynomial(std::vector<double>& coeffs) {
+    polyStart.assign(pool.size(), 0);
+    polyDegree.assign(pool.size(), -1);
+    polyTerm.assign(pool.size(), 0);
+    polyCoef.clear();
+
+    // Operands always have smaller ids than the nodes using them
+    for (int id = 0; id <= rootId; ++id) {
+        const Node& nd = pool[id];
+        int start = int(polyCoef.size());
+        int da = nd.lhs >= 0 ? polyDegree[nd.lhs] : -1;
+        int db = nd.rhs >= 0 ? polyDegree[nd.rhs] : -1;
+        auto coef = [&](int node, int k) { return polyCoef[polyStart[node] + k]; };
+        int degree = -1;
+        bool term = false;
+
+        switch (nd.op) {
+            case CE::OP_CONST:
+                polyCoef.push_back(nd.value);
+                degree = 0;
+                term = true;
+                break;
+            case CE::OP_VAR:
+                polyCoef.push_back(0.0);
+                polyCoef.push_back(1.0);
+                degree = 1;
+                term = true;
+                break;
+            case CE::OP_ADD:
+            case CE::OP_SUB:
+                if (da < 0 || db < 0) break;
+                degree = std::max(da, db);
+                for (int k = 0; k <= degree; ++k) {
+                    double a = k <= da ? coef(nd.lhs, k) : 0.0;
+                    double b = k <= db ? coef(nd.rhs, k) : 0.0;
+                    polyCoef.push_back(nd.op == CE::OP_ADD ? a + b : a - b);
+                }
+                break;
+            case CE::OP_MUL:
+                if (da < 0 || db < 0 || !(polyTerm[nd.lhs] || polyTerm[nd.rhs])) break;
+                if (da + db > kMaxPolyDegree) break;
+                degree = da + db;
+                polyCoef.resize(start + degree + 1, 0.0);
+                for (int i = 0; i <= da; ++i)
+                    for (int j = 0; j <= db; ++j)
+                        polyCoef[start + i + j] += coef(nd.lhs, i) * coef(nd.rhs, j);
+                term = polyTerm[nd.lhs] && polyTerm[nd.rhs];
+                break;
+            case CE::OP_POW: {
+                if (da < 0 || !polyTerm[nd.lhs] || !isConst(nd.rhs)) break;
+                double e = pool[nd.rhs].value;
+                if (!(e >= 0.0 && e == std::floor(e) && da * e <= kMaxPolyDegree)) break;
+                degree = da * int(e);
+                polyCoef.resize(start + degree + 1, 0.0);
+                polyCoef[start + degree] = std::pow(coef(nd.lhs, da), e);
+                term = true;
+                break;
+            }
+            default:
+                break;
+        }
+
+        if (degree < 0) continue;
+        polyStart[id] = start;
+        polyDegree[id] = degree;
+        polyTerm[id] = term;
+    }
+
+    int degree = polyDegree[rootId];
+    if (degree < 0) return false;
+
+    // Terms that cancelled or were multiplied by 0 leave leading zeros
+    const double* c = &polyCoef[polyStart[rootId]];
+    while (degree > 0 && c[degree] == 0.0) --degree;
+
+    coeffs.resize(degree + 1);
+    for (int k = 0; k <= degree; ++k)
+        coeffs[degree - k] = c[k];
+    return true;
+}
+
+CompiledExpression ExprGraph::simplify(const std::vector<Instr>& code) {
+    build(code);
+
+    CompiledExpression out;
+    out.maxDepth = emit(emitted, out.numSlots);
+    out.code.assign(emitted.begin(), emitted.end());
+
+    // Horner's rule wins unless the degree is high compared to the program
+    // (e.g. x^40, one pow call against forty multiply-adds)
+    if (polynomial(polyOut) &&
+        int(polyOut.size()) - 1 <= kHornerStepsPerInstr * int(out.code.size()))
+        out.poly.assign(polyOut.begin(), polyOut.end());
+    return out;
+}
+
+CompiledExpression ExprGraph::optimize(const CompiledExpression& in) {
+    if (in.code.empty()) return in;
+
+    ExprGraph graph;
+    CompiledExpression out = graph.simplify(in.code);
+    out.paramNames = in.paramNames;
+    out.paramValues = in.paramValues;
+    return out;
+}
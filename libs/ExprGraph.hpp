@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "CompiledExpression.hpp"
+
+// Expression DAG rebuilt from a lowered program so it can be simplified
+// before being emitted again. Nodes live in one pool and refer to their
+// operands by index. Nodes are hash-consed, so identical subexpressions
+// (e.g. the three sin(x) in sin(x)^2 + 3*sin(x) - cos(x)*sin(x)) share one
+// node and are computed once per evaluation.
+//
+// All storage is kept between build() calls, so a graph that is reused for
+// many expressions stops allocating once it has seen the largest one.
+class ExprGraph {
+public:
+    typedef CompiledExpression::OpCode OpCode;
+    typedef CompiledExpression::Instr Instr;
+
+    struct Node {
+        OpCode op;
+        double value; // OP_CONST: the constant; OP_PARAM: the parameter index
+        int lhs;      // operand indices, -1 when unused
+        int rhs;
+    };
+
+    ExprGraph() = default;
+    explicit ExprGraph(const std::vector<Instr>& code) { build(code); }
+
+    // Rebuilds the tree of a validated program, folding constants and
+    // dropping identities (+0, *1, ^1, ...) as nodes are created. Replaces
+    // whatever the graph held before.
+    void build(const std::vector<Instr>& code);
+
+    // Emits the simplified program into out and returns its stack depth.
+    // Small integer powers are expanded into multiplications here, and nodes
+    // used more than once are kept in slots; slotCount receives how many.
+    int emit(std::vector<Instr>& out, int& slotCount);
+
+    // If the built expression is a polynomial in x made of terms c x^k
+    // (sums, differences, products with at least one such term, integer
+    // powers of such a term), stores its coefficients in coeffs, highest
+    // degree first, and returns true. Products of two sums such as
+    // (x - 1)^5 are left alone: expanding them can cancel badly near their
+    // roots, where the factored form is accurate.
+    bool polynomial(std::vector<double>& coeffs);
+
+    // build() followed by emit(), returning a program whose code vector is
+    // the only allocation when the graph is reused. Polynomials that are
+    // cheaper by Horner's rule also get their coefficients.
+    CompiledExpression simplify(const std::vector<Instr>& code);
+
+    // The simplified version of a compiled expression.
+    static CompiledExpression optimize(const CompiledExpression& in);
+
+    const std::vector<Node>& nodes() const { return pool; }
+    int root() const { return rootId; }
+
+private:
+    struct EmitState {
+        std::vector<Instr>* out;
+        int slots = 0;
+        int depth = 0;
+        int maxDepth = 0;
+    };
+
+    struct EmitFrame {
+        int id;
+        int operands; // emitted so far
+    };
+
+    int make(OpCode op, int lhs, int rhs);
+    int constant(double v);
+    int intern(OpCode op, double value, int lhs, int rhs);
+    bool isConst(int id) const;
+    bool isConst(int id, double v) const;
+    void countNeed();
+    void countUses(int id);
+    void emitNode(int id, EmitState& es);
+    void rehash(size_t buckets);
+
+    std::vector<Node> pool;
+    std::vector<int> index; // open-addressing table of pool ids, -1 = empty
+    int rootId = -1;
+
+    // Scratch reused by build() and emit()
+    std::vector<int> stack;
+    std::vector<int> slotNode;
+    std::vector<int> uses;   // references to each node from the emitted DAG
+    std::vector<int> slotOf; // -1 until the node has been stored
+    std::vector<int> need;   // stack depth each node takes, see countNeed()
+    std::vector<EmitFrame> emitFrames;
+    std::vector<Instr> emitted;
+
+    // Scratch for polynomial(): each node's coefficients, lowest degree
+    // first, at polyCoef[polyStart[id]], polyDegree[id] + 1 of them
+    std::vector<int> polyStart;
+    std::vector<int> polyDegree;         // -1 when the node is not a polynomial
+    std::vector<unsigned char> polyTerm; // a single term c x^k
+    std::vector<double> polyCoef;
+    std::vector<double> polyOut;
+};
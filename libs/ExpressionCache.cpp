@@ -0,0 +1,79 @@
+#include "ExpressionCache.hpp"
+#include "Tokenizer.hpp"
+#include <functional>
+
+ExpressionCache::ExpressionCache(size_t capacity, unsigned shardCount) {
+    if (shardCount == 0) shardCount = 1;
+    perShard = (capacity + shardCount - 1) / shardCount;
+    if (perShard == 0) perShard = 1;
+
+    for (unsigned i = 0; i < shardCount; ++i)
+        shards.emplace_back(new Shard);
+}
+
+std::string ExpressionCache::normalize(std::string_view expr) {
+    std::string key;
+    normalizeInto(expr, key);
+    return key;
+}
+
+void ExpressionCache::normalizeInto(std::string_view expr, std::string& key) {
+    key.clear();
+    for (char c : expr)
+        if (c != ' ') key += c;
+}
+
+ExpressionCache::Shard& ExpressionCache::shardFor(std::string_view key) {
+    return *shards[std::hash<std::string_view>()(key) % shards.size()];
+}
+
+SharedExpression ExpressionCache::get(const std::string& expr) {
+    // Most keys have no spaces to strip; the rest are normalized into a
+    // per-thread buffer, so a hit does not allocate.
+    thread_local std::string scratch;
+    std::string_view key = expr;
+    if (expr.find(' ') != std::string::npos) {
+        normalizeInto(expr, scratch);
+        key = scratch;
+    }
+
+    Shard& shard = shardFor(key);
+    {
+        std::lock_guard<std::mutex> lock(shard.m);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+            hitCount.fetch_add(1, std::memory_order_relaxed);
+            return it->second->f;
+        }
+    }
+
+    // Parse outside the lock with this thread's own parser, so misses on one
+    // shard do not serialize
+    missCount.fetch_add(1, std::memory_order_relaxed);
+    thread_local MathParser parser;
+    SharedExpression f = std::make_shared<const CompiledExpression>(parser.compile(expr));
+
+    std::lock_guard<std::mutex> lock(shard.m);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) // another thread got here first
+        return it->second->f;
+
+    shard.lru.push_front({std::string(key), f});
+    shard.index.emplace(shard.lru.front().key, shard.lru.begin());
+
+    if (shard.lru.size() > perShard) {
+        shard.index.erase(shard.lru.back().key);
+        shard.lru.pop_back();
+    }
+    return f;
+}
+
+size_t ExpressionCache::size() const {
+    size_t n = 0;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->m);
+        n += shard->lru.size();
+    }
+    return n;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "CompiledExpression.hpp"
+
+// Bounded, thread-safe cache of compiled expressions, keyed by the
+// expression text with its spaces removed. Repeated requests for the same
+// f(x) share one SharedExpression and skip the parse entirely.
+//
+// Entries are split over independently locked shards by key hash, so
+// threads asking for different functions rarely meet on a lock. Each shard
+// evicts its least recently used entry once it holds capacity / shards
+// expressions. Handles stay valid after eviction.
+class ExpressionCache {
+public:
+    explicit ExpressionCache(size_t capacity = 1024, unsigned shards = 16);
+
+    ExpressionCache(const ExpressionCache&) = delete;
+    ExpressionCache& operator=(const ExpressionCache&) = delete;
+
+    // Returns the compiled form of expr, parsing it on a miss. Throws what
+    // MathParser::compile throws; failed parses are not cached.
+    SharedExpression get(const std::string& expr);
+
+    // The cache key of expr: the text without the spaces the parser skips.
+    static std::string normalize(std::string_view expr);
+
+    size_t size() const;
+    uint64_t hits() const { return hitCount.load(std::memory_order_relaxed); }
+    uint64_t misses() const { return missCount.load(std::memory_order_relaxed); }
+
+private:
+    struct Entry {
+        std::string key;
+        SharedExpression f;
+    };
+
+    // The map's keys view the strings held by the list nodes.
+    struct Shard {
+        mutable std::mutex m;
+        std::list<Entry> lru; // most recently used first
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+    };
+
+    static void normalizeInto(std::string_view expr, std::string& key);
+    Shard& shardFor(std::string_view key);
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    size_t perShard;
+
+    std::atomic<uint64_t> hitCount{0};
+    std::atomic<uint64_t> missCount{0};
+};
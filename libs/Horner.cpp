@@ -0,0 +1,279 @@
+#include "Horner.hpp"
+#include <cfloat>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Points (or polynomials) per block; the partial sums stay in L1.
+const size_t kChunk = 64;
+
+inline double mul_add(double a, double b, double c) {
+#ifdef __FMA__
+    return std::fma(a, b, c);
+#else
+    return a * b + c;
+#endif
+}
+
+// Error-free transformations: a + b == s + err and a * b == p + err exactly.
+template <typename T>
+inline T two_sum(T a, T b, T& err) {
+    T s = a + b;
+    T bb = s - a;
+    err = (a - (s - bb)) + (b - bb);
+    return s;
+}
+
+// Requires |a| >= |b| (or a == 0).
+template <typename T>
+inline T fast_two_sum(T a, T b, T& err) {
+    T s = a + b;
+    err = b - (s - a);
+    return s;
+}
+
+// Whether std::fma is a single instruction for T; otherwise two_prod splits
+// the operands (Dekker) rather than call a slow software fma.
+template <typename T> struct FastFma { static const bool value = false; };
+#ifdef FP_FAST_FMAF
+template <> struct FastFma<float> { static const bool value = true; };
+#endif
+#ifdef FP_FAST_FMA
+template <> struct FastFma<double> { static const bool value = true; };
+#endif
+#ifdef FP_FAST_FMAL
+template <> struct FastFma<long double> { static const bool value = true; };
+#endif
+
+// 2^ceil(digits / 2) + 1, the Veltkamp splitting constant for T.
+template <typename T>
+inline T split_constant() {
+    return T(std::ldexp(1.0L, (std::numeric_limits<T>::digits + 1) / 2)) + T(1);
+}
+
+template <typename T>
+inline T two_prod(T a, T b, T& err) {
+    T p = a * b;
+    if (FastFma<T>::value) {
+        err = std::fma(a, b, -p);
+    } else {
+        const T split = split_constant<T>();
+        T ca = split * a, ah = ca - (ca - a), al = a - ah;
+        T cb = split * b, bh = cb - (cb - b), bl = b - bh;
+        err = ((ah * bh - p) + ah * bl + al * bh) + al * bl;
+    }
+    return p;
+}
+
+// Double-double arithmetic (Joldes, Muller & Popescu 2017: relative error
+// at most 3u^2 for the sum, AccurateDWPlusDW, and 7u^2 for the product,
+// DWTimesDW1, which drops the lo * lo term; u = 2^-53).
+DoubleDouble dd_add(DoubleDouble a, DoubleDouble b) {
+    double e, f;
+    double s = two_sum(a.hi, b.hi, e);
+    double t = two_sum(a.lo, b.lo, f);
+    e += t;
+    s = fast_two_sum(s, e, e);
+    e += f;
+    s = fast_two_sum(s, e, e);
+    return {s, e};
+}
+
+DoubleDouble dd_mul(DoubleDouble a, DoubleDouble b) {
+    double e;
+    double p = two_prod(a.hi, b.hi, e);
+    e += a.hi * b.lo + a.lo * b.hi;
+    p = fast_two_sum(p, e, e);
+    return {p, e};
+}
+
+// gamma(k) = k u / (1 - k u), the usual bound on k accumulated roundings.
+template <typename T>
+inline T gamma(int k, T u) {
+    return T(k) * u / (T(1) - T(k) * u);
+}
+
+} // namespace
+
+double horner(const double* a, int n, double x) {
+    double result = a[0];
+    for (int i = 1; i <= n; ++i)
+        result = mul_add(result, x, a[i]);
+    return result;
+}
+
+double horner_derivative(const double* a, int n, double x, double& derivative) {
+    double result = a[0];
+    double d = 0.0;
+    for (int i = 1; i <= n; ++i) {
+        d = mul_add(d, x, result);
+        result = mul_add(result, x, a[i]);
+    }
+    derivative = d;
+    return result;
+}
+
+double estrin(const double* a, int n, double x) {
+    // Below one block the chain is short enough already
+    if (n < 8) return horner(a, n, x);
+
+    // c(i) is the coefficient of x^i; the top block is padded with zeros
+    auto c = [&](int i) { return i <= n ? a[n - i] : 0.0; };
+
+    double x2 = x * x;
+    double x4 = x2 * x2;
+    double x8 = x4 * x4;
+
+    // Each block of eight coefficients is a depth-3 tree of independent
+    // multiply-adds; the blocks are chained by Horner's rule in x^8
+    double result = 0.0;
+    for (int i = n / 8 * 8; i >= 0; i -= 8) {
+        double p01 = mul_add(c(i + 1), x, c(i));
+        double p23 = mul_add(c(i + 3), x, c(i + 2));
+        double p45 = mul_add(c(i + 5), x, c(i + 4));
+        double p67 = mul_add(c(i + 7), x, c(i + 6));
+        double q03 = mul_add(p23, x2, p01);
+        double q47 = mul_add(p67, x2, p45);
+        result = mul_add(result, x8, mul_add(q47, x4, q03));
+    }
+    return result;
+}
+
+void horner_points(const double* a, int n, const double* xs, double* out, size_t count) {
+    double acc[kChunk];
+    double x[kChunk];
+
+    for (size_t base = 0; base < count; base += kChunk) {
+        size_t len = (count - base < kChunk) ? count - base : kChunk;
+
+        for (size_t j = 0; j < len; ++j) {
+            x[j] = xs[base + j];
+            acc[j] = a[0];
+        }
+        for (int i = 1; i <= n; ++i) {
+            double c = a[i];
+            for (size_t j = 0; j < len; ++j)
+                acc[j] = mul_add(acc[j], x[j], c);
+        }
+        for (size_t j = 0; j < len; ++j)
+            out[base + j] = acc[j];
+    }
+}
+
+void horner_soa(const double* coeffs, int n, size_t m, const double* xs, double* out) {
+    double acc[kChunk];
+    double x[kChunk];
+
+    for (size_t base = 0; base < m; base += kChunk) {
+        size_t len = (m - base < kChunk) ? m - base : kChunk;
+
+        for (size_t j = 0; j < len; ++j) {
+            x[j] = xs[base + j];
+            acc[j] = coeffs[base + j];
+        }
+        for (int k = 1; k <= n; ++k) {
+            const double* c = coeffs + size_t(k) * m + base;
+            for (size_t j = 0; j < len; ++j)
+                acc[j] = mul_add(acc[j], x[j], c[j]);
+        }
+        for (size_t j = 0; j < len; ++j)
+            out[base + j] = acc[j];
+    }
+}
+
+void horner_complex_points(const double* a, int n, const double* re, const double* im,
+                           double* pRe, double* pIm, double* dRe, double* dIm, size_t count) {
+    double br[kChunk], bi[kChunk]; // p so far
+    double dr[kChunk], di[kChunk]; // p' so far
+    double zr[kChunk], zi[kChunk];
+
+    for (size_t base = 0; base < count; base += kChunk) {
+        size_t len = (count - base < kChunk) ? count - base : kChunk;
+
+        for (size_t j = 0; j < len; ++j) {
+            zr[j] = re[base + j];
+            zi[j] = im[base + j];
+            br[j] = a[0];
+            bi[j] = 0.0;
+            dr[j] = 0.0;
+            di[j] = 0.0;
+        }
+        for (int i = 1; i <= n; ++i) {
+            double c = a[i];
+            for (size_t j = 0; j < len; ++j) {
+                // d = d z + b, then b = b z + c
+                double ndr = mul_add(dr[j], zr[j], mul_add(-di[j], zi[j], br[j]));
+                double ndi = mul_add(dr[j], zi[j], mul_add(di[j], zr[j], bi[j]));
+                double nbr = mul_add(br[j], zr[j], mul_add(-bi[j], zi[j], c));
+                double nbi = mul_add(br[j], zi[j], bi[j] * zr[j]);
+                dr[j] = ndr; di[j] = ndi;
+                br[j] = nbr; bi[j] = nbi;
+            }
+        }
+        for (size_t j = 0; j < len; ++j) {
+            pRe[base + j] = br[j];
+            pIm[base + j] = bi[j];
+            dRe[base + j] = dr[j];
+            dIm[base + j] = di[j];
+        }
+    }
+}
+
+double horner_trace(const double* a, int n, double x, std::vector<HornerStep>& steps) {
+    double result = a[0];
+    steps.push_back({n, result});
+
+    for (int i = 1; i <= n; ++i) {
+        result = mul_add(result, x, a[i]);
+        steps.push_back({n - i, result});
+    }
+    return result;
+}
+
+template <typename T>
+CompensatedResult<T> horner_compensated(const T* a, int n, T x) {
+    const T u = std::numeric_limits<T>::epsilon() / T(2);
+    const T ax = std::fabs(x);
+
+    T s = a[0];
+    T c = T(0); // Horner of the per-step rounding errors
+    T b = T(0); // the same with |errors| at |x|, for the bound
+
+    for (int i = 1; i <= n; ++i) {
+        T pi, sigma;
+        T p = two_prod(s, x, pi);
+        s = two_sum(p, a[i], sigma);
+        c = c * x + (pi + sigma);
+        b = b * ax + (std::fabs(pi) + std::fabs(sigma));
+    }
+
+    T r = s + c;
+    T ar = std::fabs(r);
+    T bound = (u * ar + (gamma(4 * n + 2, u) * b + T(2) * u * u * ar)) / (T(1) - T(2) * T(n + 1) * u);
+    return {r, bound};
+}
+
+template <>
+CompensatedResult<DoubleDouble> horner_compensated(const DoubleDouble* a, int n, DoubleDouble x) {
+    // Each double-double operation is within 7u^2 < 2^-103 of exact
+    const double u = std::ldexp(1.0, -103);
+    const double ax = std::fabs(x.hi + x.lo);
+
+    DoubleDouble y = a[0];
+    double mu = std::fabs(y.hi) / 2;
+
+    for (int i = 1; i <= n; ++i) {
+        y = dd_add(dd_mul(y, x), a[i]);
+        mu = mu * ax + std::fabs(y.hi);
+    }
+
+    // Higham's running error bound u (2 mu - |y|), inflated for the
+    // rounding of the bound itself
+    double bound = u * (2 * mu - std::fabs(y.hi)) * (1 + 4 * DBL_EPSILON * (n + 1));
+    return {y, DoubleDouble(bound)};
+}
+
+template CompensatedResult<float> horner_compensated(const float*, int, float);
+template CompensatedResult<double> horner_compensated(const double*, int, double);
+template CompensatedResult<long double> horner_compensated(const long double*, int, long double);
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Polynomial evaluation. Coefficients are stored highest degree first, as in
+// polynomial-horner.cpp:
+//
+//     p(x) = a[0] x^n + a[1] x^(n-1) + ... + a[n]
+//
+// so a polynomial of degree n has n + 1 coefficients. None of these do I/O;
+// horner_trace records the intermediate values for callers that want to show
+// them. Multiply-adds are fused when the target has FMA.
+
+// Horner's rule at one point.
+double horner(const double* a, int n, double x);
+
+// Horner's rule that also returns p'(x) in derivative, from the same pass.
+double horner_derivative(const double* a, int n, double x, double& derivative);
+
+// Estrin's scheme at one point, on blocks of eight coefficients chained by
+// Horner's rule in x^8. The dependency chain is about n/8 + 3 multiply-adds
+// instead of n, which pays off for high degrees when the result is needed
+// right away (e.g. inside an iteration). Results may differ from horner's
+// in the last bits.
+double estrin(const double* a, int n, double x);
+
+// out[i] = p(xs[i]) for i < count. Works on blocks of points at a time so the
+// loop over points vectorizes. out may alias xs.
+void horner_points(const double* a, int n, const double* xs, double* out, size_t count);
+
+// m polynomials of degree n, each at its own point: out[j] = p_j(xs[j]).
+// Coefficients are in structure-of-arrays layout, coefficient k of
+// polynomial j at coeffs[k * m + j], so each step is one contiguous,
+// vectorizable pass over the m polynomials. out may alias xs.
+void horner_soa(const double* coeffs, int n, size_t m, const double* xs, double* out);
+
+// p(z) and p'(z) at complex points z = re[i] + i im[i], by synthetic
+// division: the partial sums of Horner's rule at z are the coefficients of
+// p(x) / (x - z), and that quotient at z is p'(z). Same blocking as
+// horner_points. The outputs must not alias the inputs.
+void horner_complex_points(const double* a, int n, const double* re, const double* im,
+                           double* pRe, double* pIm, double* dRe, double* dIm, size_t count);
+
+// One step of Horner's rule: after folding in a[n - power], the partial
+// result is value.
+struct HornerStep {
+    int power;
+    double value;
+};
+
+// horner() that also appends each partial result to steps, starting with
+// a[0] at power n and ending with p(x) at power 0.
+double horner_trace(const double* a, int n, double x, std::vector<HornerStep>& steps);
+
+// Unevaluated sum hi + lo, about 106 significant bits. Only what
+// horner_compensated needs: build one from doubles, read it back as double.
+struct DoubleDouble {
+    double hi, lo;
+
+    DoubleDouble(double v = 0.0) : hi(v), lo(0.0) {}
+    DoubleDouble(double hi, double lo) : hi(hi), lo(lo) {}
+
+    explicit operator double() const { return hi + lo; }
+};
+
+// value approximates p(x), and |value - p(x)| <= errorBound unless something
+// overflowed or underflowed.
+template <typename T>
+struct CompensatedResult {
+    T value;
+    T errorBound;
+};
+
+// Horner's rule that also tracks the rounding error of every step, using
+// the error-free transformations TwoSum and TwoProd (through FMA where the
+// target has a fast one), and adds it back at the end. The result is as
+// accurate as if it had been computed in twice the working precision and
+// then rounded, so it stays good close to roots of ill-conditioned
+// polynomials where plain horner loses every digit.
+//
+// T picks the working precision: float, double and long double run the
+// compensated scheme in that type; DoubleDouble runs Horner's rule in
+// double-double arithmetic, which is already built from the same
+// transformations. Only the instantiation a caller uses costs anything.
+// errorBound is a running bound computed alongside (Langlois & Louvet for
+// the compensated scheme, Higham's running error bound for DoubleDouble).
+template <typename T>
+CompensatedResult<T> horner_compensated(const T* a, int n, T x);
+template <>
+CompensatedResult<DoubleDouble> horner_compensated(const DoubleDouble* a, int n, DoubleDouble x);
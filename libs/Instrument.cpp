@@ -0,0 +1,140 @@
+#include "Instrument.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace {
+
+struct Registry {
+    std::mutex m;                       // guards the fields below
+    std::vector<Instrument::Block*> live;
+    Instrument::Totals retired;         // left behind by exited threads
+};
+
+// Never destroyed: threads may still retire their blocks during static
+// destruction.
+Registry& registry() {
+    static Registry* r = new Registry;
+    return *r;
+}
+
+// The per-thread block. Registered on first use, folded into the retired
+// totals when the thread exits.
+struct Owner {
+    Instrument::Block block;
+
+    Owner() {
+        for (auto& c : block.count) c.store(0, std::memory_order_relaxed);
+        for (auto& c : block.ns) c.store(0, std::memory_order_relaxed);
+        for (auto& c : block.calls) c.store(0, std::memory_order_relaxed);
+
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.m);
+        r.live.push_back(&block);
+    }
+
+    ~Owner() {
+        Instrument::tlsBlock = nullptr;
+
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.m);
+        for (int i = 0; i < Instrument::kCounters; ++i)
+            r.retired.count[i] += block.count[i].load(std::memory_order_relaxed);
+        for (int i = 0; i < Instrument::kPhases; ++i) {
+            r.retired.ns[i] += block.ns[i].load(std::memory_order_relaxed);
+            r.retired.calls[i] += block.calls[i].load(std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < r.live.size(); ++i) {
+            if (r.live[i] == &block) {
+                r.live[i] = r.live.back();
+                r.live.pop_back();
+                break;
+            }
+        }
+    }
+};
+
+const char* const kCounterNames[Instrument::kCounters] = {
+    "tokens", "rpn ops", "evaluations", "allocations", "iterations"
+};
+
+const char* const kPhaseNames[Instrument::kPhases] = {
+    "tokenize", "toRPN", "lower", "optimize", "jit", "evaluate", "newton step", "root step"
+};
+
+} // namespace
+
+void Instrument::attach() {
+    static thread_local Owner owner;
+    tlsBlock = &owner.block; // set last: registering above may allocate
+}
+
+Instrument::Totals Instrument::totals() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.m);
+
+    Totals t = r.retired;
+    for (const Block* b : r.live) {
+        for (int i = 0; i < kCounters; ++i)
+            t.count[i] += b->count[i].load(std::memory_order_relaxed);
+        for (int i = 0; i < kPhases; ++i) {
+            t.ns[i] += b->ns[i].load(std::memory_order_relaxed);
+            t.calls[i] += b->calls[i].load(std::memory_order_relaxed);
+        }
+    }
+    return t;
+}
+
+std::string Instrument::summary(const Totals& since) {
+    if (!enabled)
+        return "Instrumentation is disabled (rebuild with -DSECANT_INSTRUMENT).\n";
+
+    Totals now = totals();
+    std::string out = "--- Instrumentation (all threads) ---\n";
+    char line[128];
+
+    for (int i = 0; i < kCounters; ++i) {
+        std::snprintf(line, sizeof line, "%-12s %14llu\n", kCounterNames[i],
+                      (unsigned long long)(now.count[i] - since.count[i]));
+        out += line;
+    }
+
+    std::snprintf(line, sizeof line, "%-12s %14s %12s %12s\n", "phase", "calls", "total ms", "ns/call");
+    out += line;
+    for (int i = 0; i < kPhases; ++i) {
+        uint64_t calls = now.calls[i] - since.calls[i];
+        uint64_t ns = now.ns[i] - since.ns[i];
+        if (calls == 0) continue;
+        std::snprintf(line, sizeof line, "%-12s %14llu %12.3f %12.1f\n", kPhaseNames[i],
+                      (unsigned long long)calls, ns * 1e-6, double(ns) / double(calls));
+        out += line;
+    }
+    return out;
+}
+
+#ifdef SECANT_INSTRUMENT
+
+// Counting replacements for the global allocation functions. Threads that
+// have not recorded anything yet are not counted, which keeps the counter
+// from recursing into its own registration.
+
+void* operator new(std::size_t size) {
+    if (Instrument::Block* b = Instrument::tlsBlock)
+        Instrument::bump(b->count[Instrument::ALLOCATIONS], 1);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+#endif
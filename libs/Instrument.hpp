@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#ifdef SECANT_INSTRUMENT
+#include <chrono>
+#endif
+
+// Opt-in counters and phase timers for the parser, the evaluator and the
+// solvers. Build with -DSECANT_INSTRUMENT to turn them on; otherwise the
+// INSTR_* macros expand to nothing and the hot paths compile exactly as
+// before.
+//
+// Every thread writes only to its own block, so recording never contends.
+// totals() sums the blocks of all live threads plus whatever exited threads
+// left behind.
+class Instrument {
+public:
+    enum Counter {
+        TOKENS,       // tokens produced by MathParser::tokenize
+        RPN_OPS,      // opcodes executed by the evaluators
+        EVALUATIONS,  // f(x) evaluations (one per point)
+        ALLOCATIONS,  // operator new calls
+        ITERATIONS,   // solver steps
+        kCounters
+    };
+
+    enum Phase {
+        TOKENIZE,
+        TO_RPN,
+        LOWER,
+        OPTIMIZE,
+        NATIVE,       // JitCode::compile
+        EVALUATE,     // the evaluation inside MathParser::evaluate
+        NEWTON_STEP,
+        ROOT_STEP,    // RootSolver::step
+        kPhases
+    };
+
+    struct Totals {
+        uint64_t count[kCounters] = {};
+        uint64_t ns[kPhases] = {};
+        uint64_t calls[kPhases] = {};
+    };
+
+#ifdef SECANT_INSTRUMENT
+    static const bool enabled = true;
+#else
+    static const bool enabled = false;
+#endif
+
+    // Sum over all threads so far. All zero when instrumentation is off.
+    static Totals totals();
+
+    // Table of what was recorded since 'since' (a previous totals() result).
+    static std::string summary(const Totals& since);
+
+    struct Block {
+        std::atomic<uint64_t> count[kCounters];
+        std::atomic<uint64_t> ns[kPhases];
+        std::atomic<uint64_t> calls[kPhases];
+    };
+
+    // Only the owning thread writes, so a plain load and store is enough;
+    // the atomics just keep totals() from reading torn values.
+    static void bump(std::atomic<uint64_t>& c, uint64_t n) {
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static Block& local() {
+        if (!tlsBlock) attach();
+        return *tlsBlock;
+    }
+
+    static void add(Counter c, uint64_t n) { bump(local().count[c], n); }
+
+    static void addTime(Phase p, uint64_t ns) {
+        Block& b = local();
+        bump(b.ns[p], ns);
+        bump(b.calls[p], 1);
+    }
+
+    // Null until the thread records its first event. operator new reads it
+    // directly so that counting an allocation never allocates.
+    static inline thread_local Block* tlsBlock = nullptr;
+
+#ifdef SECANT_INSTRUMENT
+    // Adds the lifetime of the enclosing scope to a phase.
+    class Timer {
+    public:
+        explicit Timer(Phase p) : phase(p), start(std::chrono::steady_clock::now()) {}
+        ~Timer() {
+            addTime(phase, uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count()));
+        }
+
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+    private:
+        Phase phase;
+        std::chrono::steady_clock::time_point start;
+    };
+#endif
+
+private:
+    static void attach();
+};
+
+#ifdef SECANT_INSTRUMENT
+#define INSTR_CONCAT_(a, b) a##b
+#define INSTR_CONCAT(a, b) INSTR_CONCAT_(a, b)
+#define INSTR_COUNT(counter, n) Instrument::add(Instrument::counter, uint64_t(n))
+#define INSTR_SCOPE(phase) Instrument::Timer INSTR_CONCAT(instrTimer, __LINE__)(Instrument::phase)
+#else
+#define INSTR_COUNT(counter, n) ((void)0)
+#define INSTR_SCOPE(phase) ((void)0)
+#endif
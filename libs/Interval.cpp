@@ -0,0 +1,158 @@
+#include "Interval.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const double kInf = std::numeric_limits<double>::infinity();
+const double kPi = 3.14159265358979323846;
+
+// At least one ulp below / above v (two at a power of two), without the
+// call std::nextafter costs. Infinities stay put.
+inline double down(double v) { return std::isinf(v) ? v : v - (std::fabs(v) * DBL_EPSILON + DBL_TRUE_MIN); }
+inline double up(double v) { return std::isinf(v) ? v : v + (std::fabs(v) * DBL_EPSILON + DBL_TRUE_MIN); }
+
+// Widens round-to-nearest bounds outward. A NaN bound can only come from
+// inf - inf or the like here, and then the side is unbounded.
+Interval outward(double lo, double hi) {
+    return Interval(std::isnan(lo) ? -kInf : down(lo), std::isnan(hi) ? kInf : up(hi));
+}
+
+// Product of two bounds where 0 * inf counts as 0: a zero bound is exact,
+// whatever the other interval reaches.
+inline double boundProduct(double a, double b) { return (a == 0.0 || b == 0.0) ? 0.0 : a * b; }
+
+// Whether [lo, hi] contains phase + k * period for some integer k. Errs on
+// the side of yes near the edges, which only widens the result.
+bool reaches(double lo, double hi, double phase, double period) {
+    double tlo = (lo - phase) / period;
+    double thi = (hi - phase) / period;
+    double slack = 1e-9 + 4.0 * DBL_EPSILON * std::max(std::fabs(tlo), std::fabs(thi));
+    return std::floor(thi + slack) >= std::ceil(tlo - slack);
+}
+
+// An exact zero operand gives an exact result, so the derivative of a
+// constant stays [0, 0] instead of growing by an ulp per operation.
+inline bool isZero(const Interval& a) { return a.lo == 0.0 && a.hi == 0.0; }
+
+inline Interval clampUnit(Interval r) {
+    return Interval(std::max(r.lo, -1.0), std::min(r.hi, 1.0));
+}
+
+// a^n for an integer n > 0, using the sign of a.
+Interval powInteger(const Interval& a, double n) {
+    double plo = std::pow(a.lo, n), phi = std::pow(a.hi, n);
+    if (std::fmod(n, 2.0) != 0.0) return outward(plo, phi); // odd: increasing
+    if (a.lo >= 0.0) return outward(plo, phi);
+    if (a.hi <= 0.0) return outward(phi, plo);
+    return Interval(0.0, up(std::max(plo, phi)));             // even, straddles 0
+}
+
+} // namespace
+
+Interval Interval::empty() { return Interval(NAN, NAN); }
+Interval Interval::entire() { return Interval(-kInf, kInf); }
+
+Interval operator+(const Interval& a, const Interval& b) {
+    if (a.isEmpty() || b.isEmpty()) return Interval::empty();
+    if (isZero(b)) return a;
+    if (isZero(a)) return b;
+    return outward(a.lo + b.lo, a.hi + b.hi);
+}
+
+Interval operator-(const Interval& a, const Interval& b) {
+    if (a.isEmpty() || b.isEmpty()) return Interval::empty();
+    if (isZero(b)) return a;
+    return outward(a.lo - b.hi, a.hi - b.lo);
+}
+
+Interval operator*(const Interval& a, const Interval& b) {
+    if (a.isEmpty() || b.isEmpty()) return Interval::empty();
+    if (isZero(a) || isZero(b)) return Interval(0.0);
+    double p1 = boundProduct(a.lo, b.lo), p2 = boundProduct(a.lo, b.hi);
+    double p3 = boundProduct(a.hi, b.lo), p4 = boundProduct(a.hi, b.hi);
+    return outward(std::min(std::min(p1, p2), std::min(p3, p4)),
+                   std::max(std::max(p1, p2), std::max(p3, p4)));
+}
+
+Interval operator/(const Interval& a, const Interval& b) {
+    if (a.isEmpty() || b.isEmpty()) return Interval::empty();
+    if (isZero(b)) return Interval::empty();
+
+    // 1/b, then a * (1/b); a divisor with 0 strictly inside can be anything
+    Interval inv;
+    if (b.lo > 0.0 || b.hi < 0.0) inv = outward(1.0 / b.hi, 1.0 / b.lo);
+    else if (b.lo == 0.0)         inv = Interval(down(1.0 / b.hi), kInf);
+    else if (b.hi == 0.0)         inv = Interval(-kInf, up(1.0 / b.lo));
+    else return Interval::entire();
+    return a * inv;
+}
+
+Interval pow(const Interval& a, const Interval& b) {
+    if (a.isEmpty() || b.isEmpty()) return Interval::empty();
+
+    // Constant integer exponents, the usual x^2 and x^3: exact in the sign of a
+    if (b.lo == b.hi && b.lo == std::floor(b.lo) && std::fabs(b.lo) < 1e15) {
+        double n = b.lo;
+        if (n == 0.0) return Interval(1.0);
+        if (n > 0.0) return powInteger(a, n);
+        return Interval(1.0) / powInteger(a, -n);
+    }
+
+    // Otherwise std::pow is NaN for a < 0, except at integer exponents
+    Interval base = a;
+    if (base.lo < 0.0) {
+        bool integerInside = b.lo != b.hi && std::floor(b.hi) >= b.lo;
+        if (integerInside) return Interval::entire();
+        if (base.hi < 0.0) return Interval::empty();
+        base.lo = 0.0;
+    }
+
+    // On base >= 0, pow is monotonic in each argument: the extremes are corners
+    double c1 = std::pow(base.lo, b.lo), c2 = std::pow(base.lo, b.hi);
+    double c3 = std::pow(base.hi, b.lo), c4 = std::pow(base.hi, b.hi);
+    return outward(std::max(0.0, std::min(std::min(c1, c2), std::min(c3, c4))),
+                   std::max(std::max(c1, c2), std::max(c3, c4)));
+}
+
+Interval sin(const Interval& a) {
+    if (a.isEmpty()) return Interval::empty();
+    if (!(a.width() < 2.0 * kPi)) return Interval(-1.0, 1.0);
+
+    double s1 = std::sin(a.lo), s2 = std::sin(a.hi);
+    Interval r = outward(std::min(s1, s2), std::max(s1, s2));
+    if (reaches(a.lo, a.hi, 0.5 * kPi, 2.0 * kPi)) r.hi = 1.0;
+    if (reaches(a.lo, a.hi, -0.5 * kPi, 2.0 * kPi)) r.lo = -1.0;
+    return clampUnit(r);
+}
+
+Interval cos(const Interval& a) {
+    if (a.isEmpty()) return Interval::empty();
+    if (!(a.width() < 2.0 * kPi)) return Interval(-1.0, 1.0);
+
+    double c1 = std::cos(a.lo), c2 = std::cos(a.hi);
+    Interval r = outward(std::min(c1, c2), std::max(c1, c2));
+    if (reaches(a.lo, a.hi, 0.0, 2.0 * kPi)) r.hi = 1.0;
+    if (reaches(a.lo, a.hi, kPi, 2.0 * kPi)) r.lo = -1.0;
+    return clampUnit(r);
+}
+
+Interval tan(const Interval& a) {
+    if (a.isEmpty()) return Interval::empty();
+    if (!(a.width() < kPi) || reaches(a.lo, a.hi, 0.5 * kPi, kPi)) return Interval::entire();
+    return outward(std::tan(a.lo), std::tan(a.hi)); // increasing between poles
+}
+
+Interval exp(const Interval& a) {
+    if (a.isEmpty()) return Interval::empty();
+    Interval r = outward(std::exp(a.lo), std::exp(a.hi));
+    r.lo = std::max(r.lo, 0.0);
+    return r;
+}
+
+Interval log(const Interval& a) {
+    if (a.isEmpty() || !(a.hi > 0.0)) return Interval::empty();
+    return Interval(a.lo > 0.0 ? down(std::log(a.lo)) : -kInf, up(std::log(a.hi)));
+}
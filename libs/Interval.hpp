@@ -0,0 +1,46 @@
+#pragma once
+
+// A closed interval [lo, hi] of doubles, possibly unbounded. An interval
+// with NaN bounds is empty: the function it came from is undefined
+// everywhere on the input (log of [-2, -1]).
+//
+// The operations enclose the exact result: each bound is computed in
+// round-to-nearest and then moved at least one ulp outward. That covers the
+// half-ulp error of +, -, * and / and the sub-ulp error of glibc's sin, cos,
+// tan, exp, log and pow, without switching the FPU rounding mode (which the
+// compiler and libm do not honour reliably). The price is an ulp or two of
+// width per operation.
+//
+// Where a function is undefined on part of its input (log of [-1, 2]), the
+// result encloses it on the part where it is defined; a root of f cannot
+// lie where f is NaN.
+struct Interval {
+    double lo, hi;
+
+    Interval() : lo(0.0), hi(0.0) {}
+    explicit Interval(double v) : lo(v), hi(v) {}
+    Interval(double lo, double hi) : lo(lo), hi(hi) {}
+
+    static Interval empty();
+    static Interval entire(); // [-inf, inf]
+
+    bool isEmpty() const { return !(lo <= hi); }
+    bool contains(double v) const { return lo <= v && v <= hi; }
+    double width() const { return hi - lo; }
+    double mid() const { return 0.5 * lo + 0.5 * hi; }
+};
+
+Interval operator+(const Interval& a, const Interval& b);
+Interval operator-(const Interval& a, const Interval& b);
+Interval operator*(const Interval& a, const Interval& b);
+Interval operator/(const Interval& a, const Interval& b);
+
+// a^b as std::pow computes it: integer exponents follow the sign of a,
+// others need a >= 0.
+Interval pow(const Interval& a, const Interval& b);
+
+Interval sin(const Interval& a);
+Interval cos(const Interval& a);
+Interval tan(const Interval& a);
+Interval exp(const Interval& a);
+Interval log(const Interval& a);
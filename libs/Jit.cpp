@@ -0,0 +1,356 @@
+#include "Jit.hpp"
+
+#ifdef SECANT_JIT
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+typedef CompiledExpression CE;
+
+// xmm0 .. xmm14 hold stack entries 0 .. 14, xmm15 holds x; xmm14 is also
+// scratch while the prologue copies the parameters. Every xmm register is
+// caller-saved in the System V ABI, so nothing needs saving on entry, and
+// everything live has to be spilled around a call.
+const int kStackRegs = 15;
+const int kRegX = 15;
+
+// SSE2 scalar double instructions: prefix 0F opcode /r
+const uint8_t kPrefixSD = 0xF2; // movsd, addsd, ...
+const uint8_t kPrefixPD = 0x66; // movapd
+const uint8_t kMovLoad = 0x10;  // movsd xmm, xmm/m64
+const uint8_t kMovStore = 0x11; // movsd m64, xmm
+const uint8_t kMovApd = 0x28;   // movapd xmm, xmm
+const uint8_t kAdd = 0x58;
+const uint8_t kMul = 0x59;
+const uint8_t kSub = 0x5C;
+const uint8_t kDiv = 0x5E;
+
+double callSin(double v) { return std::sin(v); }
+double callCos(double v) { return std::cos(v); }
+double callTan(double v) { return std::tan(v); }
+double callExp(double v) { return std::exp(v); }
+double callLog(double v) { return std::log(v); }
+double callPow(double a, double b) { return std::pow(a, b); }
+
+// Where the value of a stack entry is. Only REG entries occupy their
+// register (xmm<position>); the others are read straight from memory, or
+// from xmm15 for x, by the instruction that consumes them.
+struct Value {
+    enum Kind { REG, X, CONST, PARAM, SLOT, SPILL } kind;
+    int index; // CONST: constant pool index; PARAM, SLOT: its number
+};
+
+class Assembler {
+public:
+    explicit Assembler(const CE& f)
+        : params(int(f.parameters().size())),
+          frame(8 * (1 + params + f.slotCount() + f.stackDepth())) {
+        // rsp is 8 past a 16-byte boundary on entry; keep calls aligned
+        if (frame % 16 == 0) frame += 8;
+    }
+
+    void translate(const std::vector<CE::Instr>& program);
+    std::vector<uint8_t> finish();
+
+private:
+    // Frame: x at [rsp], then the parameters, the slots, and one spill slot
+    // per entry
+    int paramOffset(int param) const { return 8 + 8 * param; }
+    int slotOffset(int slot) const { return 8 + 8 * (params + slot); }
+    int spillOffset(int pos) const { return frame - 8 - 8 * pos; }
+
+    void byte(uint8_t b) { code.push_back(b); }
+    void dword(uint32_t v) { for (int i = 0; i < 4; ++i) byte(uint8_t(v >> (8 * i))); }
+
+    void sse(uint8_t prefix, int reg, int rm) {
+        byte(prefix);
+        uint8_t rex = 0x40 | ((reg & 8) ? 4 : 0) | ((rm & 8) ? 1 : 0);
+        if (rex != 0x40) byte(rex);
+        byte(0x0F);
+    }
+
+    // op xmm<reg>, xmm<rm>
+    void regReg(uint8_t prefix, uint8_t op, int reg, int rm) {
+        sse(prefix, reg, rm);
+        byte(op);
+        byte(0xC0 | (reg & 7) << 3 | (rm & 7));
+    }
+
+    // op xmm<reg>, [rsp + disp] (or the store the other way round)
+    void regStack(uint8_t op, int reg, int disp) {
+        sse(kPrefixSD, reg, 0);
+        byte(op);
+        if (disp == 0) {
+            byte(0x04 | (reg & 7) << 3);
+            byte(0x24);
+        } else if (disp < 128) {
+            byte(0x44 | (reg & 7) << 3);
+            byte(0x24);
+            byte(uint8_t(disp));
+        } else {
+            byte(0x84 | (reg & 7) << 3);
+            byte(0x24);
+            dword(uint32_t(disp));
+        }
+    }
+
+    // movsd xmm<reg>, [rdi + disp]
+    void loadArgument(int reg, int disp) {
+        sse(kPrefixSD, reg, 0);
+        byte(kMovLoad);
+        if (disp < 128) {
+            byte(0x47 | (reg & 7) << 3);
+            byte(uint8_t(disp));
+        } else {
+            byte(0x87 | (reg & 7) << 3);
+            dword(uint32_t(disp));
+        }
+    }
+
+    // op xmm<reg>, [rip + constant], patched in finish()
+    void regConst(uint8_t op, int reg, int index) {
+        sse(kPrefixSD, reg, 0);
+        byte(op);
+        byte(0x05 | (reg & 7) << 3);
+        fixups.push_back({code.size(), index});
+        dword(0);
+    }
+
+    void moveReg(int dst, int src) {
+        if (dst != src) regReg(kPrefixPD, kMovApd, dst, src);
+    }
+
+    int constant(double v);
+    void operand(uint8_t op, int reg, int pos);
+    void load(int reg, int pos);
+    void materialize(int pos) {
+        if (stack[pos].kind == Value::REG) return;
+        load(pos, pos);
+        stack[pos] = {Value::REG, 0};
+    }
+    void spillBelow(int count);
+    void call(const void* target);
+
+    struct Fixup {
+        size_t at;
+        int index;
+    };
+
+    int params;
+    int frame;
+    std::vector<uint8_t> code;
+    std::vector<double> constants;
+    std::vector<Fixup> fixups;
+    std::vector<Value> stack;
+    bool xLive = true; // xmm15 still holds x (no call since it was loaded)
+};
+
+int Assembler::constant(double v) {
+    for (size_t i = 0; i < constants.size(); ++i)
+        if (std::memcmp(&constants[i], &v, sizeof v) == 0) return int(i);
+    constants.push_back(v);
+    return int(constants.size()) - 1;
+}
+
+// op xmm<reg>, <value of entry pos>
+void Assembler::operand(uint8_t op, int reg, int pos) {
+    const Value& v = stack[pos];
+    switch (v.kind) {
+        case Value::REG:   regReg(kPrefixSD, op, reg, pos); break;
+        case Value::CONST: regConst(op, reg, v.index); break;
+        case Value::PARAM: regStack(op, reg, paramOffset(v.index)); break;
+        case Value::SLOT:  regStack(op, reg, slotOffset(v.index)); break;
+        case Value::SPILL: regStack(op, reg, spillOffset(pos)); break;
+        case Value::X:
+            if (!xLive) {
+                regStack(kMovLoad, kRegX, 0);
+                xLive = true;
+            }
+            regReg(kPrefixSD, op, reg, kRegX);
+            break;
+    }
+}
+
+// xmm<reg> = value of entry pos
+void Assembler::load(int reg, int pos) {
+    const Value& v = stack[pos];
+    if (v.kind == Value::REG) {
+        moveReg(reg, pos);
+    } else if (v.kind == Value::X) {
+        if (!xLive) {
+            regStack(kMovLoad, kRegX, 0);
+            xLive = true;
+        }
+        moveReg(reg, kRegX);
+    } else {
+        operand(kMovLoad, reg, pos);
+    }
+}
+
+// Entries 0 .. count-1 that are in registers go to their spill slots.
+void Assembler::spillBelow(int count) {
+    for (int i = 0; i < count; ++i) {
+        if (stack[i].kind != Value::REG) continue;
+        regStack(kMovStore, i, spillOffset(i));
+        stack[i] = {Value::SPILL, 0};
+    }
+}
+
+void Assembler::call(const void* target) {
+    uint64_t address = uint64_t(reinterpret_cast<uintptr_t>(target));
+    byte(0x48); byte(0xB8); // mov rax, imm64
+    for (int i = 0; i < 8; ++i) byte(uint8_t(address >> (8 * i)));
+    byte(0xFF); byte(0xD0); // call rax
+    xLive = false;
+}
+
+void Assembler::translate(const std::vector<CE::Instr>& program) {
+    // sub rsp, frame; movsd [rsp], xmm0; movapd xmm15, xmm0
+    byte(0x48); byte(0x81); byte(0xEC); dword(uint32_t(frame));
+    regStack(kMovStore, 0, 0);
+    moveReg(kRegX, 0);
+
+    // The parameter pointer (rdi) does not survive calls; the values do
+    for (int i = 0; i < params; ++i) {
+        loadArgument(14, 8 * i);
+        regStack(kMovStore, 14, paramOffset(i));
+    }
+
+    for (const CE::Instr& in : program) {
+        int top = int(stack.size()) - 1;
+
+        switch (in.op) {
+            case CE::OP_CONST: stack.push_back({Value::CONST, constant(in.imm)}); break;
+            case CE::OP_VAR:   stack.push_back({Value::X, 0}); break;
+            case CE::OP_LOAD:  stack.push_back({Value::SLOT, in.arg}); break;
+            case CE::OP_PARAM: stack.push_back({Value::PARAM, in.arg}); break;
+
+            case CE::OP_DUP:
+                if (stack[top].kind == Value::REG || stack[top].kind == Value::SPILL) {
+                    load(top + 1, top);
+                    stack.push_back({Value::REG, 0});
+                } else {
+                    stack.push_back(stack[top]);
+                }
+                break;
+
+            case CE::OP_STORE:
+                // Entries still waiting to read the old slot value read it now
+                for (int i = 0; i < top; ++i)
+                    if (stack[i].kind == Value::SLOT && stack[i].index == in.arg) materialize(i);
+                materialize(top);
+                regStack(kMovStore, top, slotOffset(in.arg));
+                break;
+
+            case CE::OP_ADD:
+            case CE::OP_SUB:
+            case CE::OP_MUL:
+            case CE::OP_DIV: {
+                uint8_t op = in.op == CE::OP_ADD ? kAdd : in.op == CE::OP_SUB ? kSub
+                           : in.op == CE::OP_MUL ? kMul : kDiv;
+                materialize(top - 1);
+                operand(op, top - 1, top);
+                stack.pop_back();
+                break;
+            }
+
+            case CE::OP_POW:
+                // The base goes to xmm0 first: the exponent is never there
+                spillBelow(top - 1);
+                load(0, top - 1);
+                load(1, top);
+                call(reinterpret_cast<const void*>(&callPow));
+                moveReg(top - 1, 0);
+                stack.pop_back();
+                stack[top - 1] = {Value::REG, 0};
+                break;
+
+            case CE::OP_SIN:
+            case CE::OP_COS:
+            case CE::OP_TAN:
+            case CE::OP_EXP:
+            case CE::OP_LOG: {
+                double (*fn)(double) = in.op == CE::OP_SIN ? callSin : in.op == CE::OP_COS ? callCos
+                                     : in.op == CE::OP_TAN ? callTan : in.op == CE::OP_EXP ? callExp
+                                     : callLog;
+                spillBelow(top);
+                load(0, top);
+                call(reinterpret_cast<const void*>(fn));
+                moveReg(top, 0);
+                stack[top] = {Value::REG, 0};
+                break;
+            }
+        }
+    }
+
+    // The result is entry 0, whose register is the return register
+    materialize(0);
+    byte(0x48); byte(0x81); byte(0xC4); dword(uint32_t(frame)); // add rsp, frame
+    byte(0xC3);                                                 // ret
+}
+
+// Appends the constant pool, 8-byte aligned, and resolves the references.
+std::vector<uint8_t> Assembler::finish() {
+    while (code.size() % 8) byte(0xCC);
+    size_t pool = code.size();
+    code.resize(pool + constants.size() * sizeof(double));
+    if (!constants.empty())
+        std::memcpy(&code[pool], constants.data(), constants.size() * sizeof(double));
+
+    for (const Fixup& f : fixups) {
+        int32_t disp = int32_t(pool + f.index * sizeof(double) - (f.at + 4));
+        std::memcpy(&code[f.at], &disp, sizeof disp);
+    }
+    return code;
+}
+
+} // namespace
+
+bool JitCode::available() { return true; }
+
+std::shared_ptr<const JitCode> JitCode::compile(const CompiledExpression& f) {
+    if (f.program().empty() || f.isPolynomial() || f.stackDepth() > kStackRegs) return nullptr;
+
+    Assembler as(f);
+    as.translate(f.program());
+    std::vector<uint8_t> bytes = as.finish();
+
+    size_t page = size_t(sysconf(_SC_PAGESIZE));
+    size_t mapped = (bytes.size() + page - 1) / page * page;
+    void* memory = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) return nullptr;
+
+    std::memcpy(memory, bytes.data(), bytes.size());
+    if (mprotect(memory, mapped, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, mapped);
+        return nullptr;
+    }
+    return std::shared_ptr<const JitCode>(new JitCode(memory, mapped, bytes.size()));
+}
+
+JitCode::JitCode(void* memory, size_t mapped, size_t length)
+    : memory(memory), mapped(mapped), length(length),
+      entry(reinterpret_cast<Function>(memory)) {}
+
+JitCode::~JitCode() {
+    munmap(memory, mapped);
+}
+
+#else // no JIT in this build
+
+bool JitCode::available() { return false; }
+
+std::shared_ptr<const JitCode> JitCode::compile(const CompiledExpression&) { return nullptr; }
+
+JitCode::JitCode(void* memory, size_t mapped, size_t length)
+    : memory(memory), mapped(mapped), length(length), entry(nullptr) {}
+
+JitCode::~JitCode() {}
+
+#endif
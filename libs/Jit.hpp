@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include "CompiledExpression.hpp"
+
+// Native code backend for CompiledExpression: translates the stack-machine
+// program into x86-64 machine code for one function
+// double f(double x, const double* parameters), so evaluating it costs no
+// dispatch at all.
+//
+// The value stack lives in registers: entry i of the stack is xmm<i>, and x
+// is kept in xmm15. Parameters are copied into the stack frame on entry.
+// Constants, x, parameters and stored slots are not loaded until an
+// instruction needs them, and then usually as the memory operand of that
+// instruction (mulsd xmm1, [constant]). sin, cos, tan, exp, log and ^ are
+// calls into libm; the registers live across a call are spilled around it.
+// The code is written into its own pages, which are made executable (and no
+// longer writable) before use.
+//
+// Only built for x86-64 with the System V calling convention (Linux, the
+// BSDs, macOS); -DSECANT_NO_JIT leaves it out everywhere. Without it
+// compile() always returns null and callers keep using the interpreter.
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__)) && \
+    !defined(SECANT_NO_JIT)
+#define SECANT_JIT 1
+#endif
+
+class JitCode {
+public:
+    typedef double (*Function)(double x, const double* parameters);
+
+    // Native code for f, or null when this build has no JIT, f is empty,
+    // its stack is deeper than the registers available, or executable
+    // memory cannot be had. Polynomials are not compiled: their Horner loop
+    // is already native.
+    static std::shared_ptr<const JitCode> compile(const CompiledExpression& f);
+
+    // Whether compile() can succeed at all in this build.
+    static bool available();
+
+    Function function() const { return entry; }
+    size_t codeSize() const { return length; }
+
+    ~JitCode();
+    JitCode(const JitCode&) = delete;
+    JitCode& operator=(const JitCode&) = delete;
+
+private:
+    JitCode(void* memory, size_t mapped, size_t length);
+
+    void* memory;
+    size_t mapped; // bytes mapped, a whole number of pages
+    size_t length; // bytes of code and constants
+    Function entry;
+};
@@ -0,0 +1,76 @@
+#include "ParameterSweep.hpp"
+#include <algorithm>
+
+ParameterSweep::ParameterSweep(const CompiledExpression& f, int param, ThreadPool& pool)
+    : f(f), param(param), pool(pool) {}
+
+std::vector<double> ParameterSweep::range(double first, double last, size_t count) {
+    std::vector<double> values(count);
+    for (size_t i = 0; i < count; ++i)
+        values[i] = count > 1 ? first + (last - first) * double(i) / double(count - 1) : first;
+    return values;
+}
+
+ParameterSweep::Point ParameterSweep::solveOne(CompiledExpression& g, double p, Track& track,
+                                               double x1, double x2, const SweepOptions& opts) const {
+    if (opts.warmStart && track.known == 2 && track.p[1] != track.p[0]) {
+        // Secant prediction along the branch; the last root is the other point
+        double slope = (track.root[1] - track.root[0]) / (track.p[1] - track.p[0]);
+        x1 = track.root[1];
+        x2 = track.root[1] + slope * (p - track.p[1]);
+    } else if (opts.warmStart && track.known >= 1) {
+        // RootSolver moves equal starting points apart
+        x1 = x2 = track.root[1];
+    }
+
+    g.setParameter(param, p);
+    RootSolver solver(g, opts.method, x1, x2, opts.solve);
+    RootSolver::Status status = solver.solve();
+    Point pt{p, solver.root(), solver.value(), solver.iterations(), solver.evaluations(), status};
+
+    if (status == RootSolver::CONVERGED) {
+        track.p[0] = track.p[1];
+        track.root[0] = track.root[1];
+        track.p[1] = p;
+        track.root[1] = pt.root;
+        track.known = std::min(track.known + 1, 2);
+    } else {
+        track.known = 0; // lost the branch: start again from x1, x2
+    }
+    return pt;
+}
+
+std::vector<ParameterSweep::Point> ParameterSweep::run(const std::vector<double>& values, double x1, double x2,
+                                                       const SweepOptions& opts) const {
+    const size_t n = values.size();
+    const size_t chunk = std::max<size_t>(opts.chunk, 1);
+    std::vector<Point> out(n);
+    if (n == 0) return out;
+
+    // 1. The first value of every chunk, in order, so that every chunk
+    //    starts on the branch the sweep is following
+    std::vector<Track> heads((n + chunk - 1) / chunk);
+    CompiledExpression g = f;
+    Track track;
+    for (size_t c = 0; c < heads.size(); ++c) {
+        size_t i = c * chunk;
+        out[i] = solveOne(g, values[i], track, x1, x2, opts);
+        heads[c] = track; // the chunk predicts from this head and the one before
+    }
+
+    // 2. The rest of every chunk, concurrently; each task owns its range
+    TaskGroup tasks(pool);
+    for (size_t c = 0; c < heads.size(); ++c) {
+        size_t begin = c * chunk + 1, end = std::min(n, (c + 1) * chunk);
+        if (begin >= end) continue;
+
+        tasks.submit([this, &values, &out, &opts, &heads, c, begin, end, x1, x2] {
+            CompiledExpression local = f;
+            Track t = heads[c];
+            for (size_t i = begin; i < end; ++i)
+                out[i] = solveOne(local, values[i], t, x1, x2, opts);
+        });
+    }
+    tasks.wait();
+    return out;
+}
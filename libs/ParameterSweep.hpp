@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include "CompiledExpression.hpp"
+#include "Solvers.hpp"
+#include "ThreadPool.hpp"
+
+struct SweepOptions {
+    RootSolver::Method method = RootSolver::SECANT;
+    SolveOptions solve;     // per solve
+    size_t chunk = 256;     // parameter values per pool task
+    bool warmStart = true;  // false: every solve starts from x1, x2
+};
+
+// Solves f(x; p) = 0 for many values of one parameter p, following one root
+// as p changes. Each solve starts where the roots of the previous two values
+// predict the next one (linear extrapolation in p), which typically takes a
+// solve from about eight iterations down to two or three.
+//
+// The values are split into chunks solved concurrently on the pool. The
+// first value of every chunk is solved first, in order, each warm-started
+// from the one before, so all chunks start on the same branch of roots;
+// inside a chunk the solves continue from there. The values should be
+// ordered (e.g. increasing) for the predictions to be any good.
+class ParameterSweep {
+public:
+    struct Point {
+        double p;
+        double root, froot;
+        int iterations, evaluations;
+        RootSolver::Status status;
+    };
+
+    // param is an index into f.parameters(). The other parameters keep the
+    // values f has; each task works on its own copy of f.
+    ParameterSweep(const CompiledExpression& f, int param, ThreadPool& pool);
+
+    // One point per value, in the same order. x1 and x2 start the first
+    // solve, and any solve after a failed one.
+    std::vector<Point> run(const std::vector<double>& values, double x1, double x2,
+                           const SweepOptions& opts = SweepOptions()) const;
+
+    // count values evenly spaced from first to last.
+    static std::vector<double> range(double first, double last, size_t count);
+
+private:
+    // The last two converged solves, oldest first, for the next prediction.
+    struct Track {
+        double p[2], root[2];
+        int known = 0;
+    };
+
+    Point solveOne(CompiledExpression& g, double p, Track& track, double x1, double x2,
+                   const SweepOptions& opts) const;
+
+    const CompiledExpression& f;
+    int param;
+    ThreadPool& pool;
+};
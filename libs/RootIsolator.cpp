@@ -0,0 +1,168 @@
+#include "RootIsolator.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+bool signsDiffer(double a, double b) {
+    return std::isfinite(a) && std::isfinite(b) && a != 0.0 && b != 0.0 && (a < 0) != (b < 0);
+}
+
+} // namespace
+
+RootIsolator::RootIsolator(const CompiledExpression& f, ThreadPool& pool)
+    : f(f), pool(pool) {}
+
+RootIsolator::Isolation RootIsolator::isolate(double a, double b, const IsolateOptions& opts) const {
+    if (a > b) std::swap(a, b);
+    const double minWidth = opts.minWidth * (b - a);
+
+    Isolation out;
+    std::vector<Bracket>& found = out.brackets;
+
+    // A box whose end is an exact zero does not change sign, so zeros are
+    // recorded where the ends are first evaluated
+    std::vector<Bracket> zeros;
+    auto point = [&](double x) {
+        double fx = f(x);
+        out.evaluations++;
+        if (fx == 0.0) zeros.push_back({x, x, 0.0, 0.0, false, true});
+        return fx;
+    };
+
+    // Depth first, left half first, so brackets come out in order
+    std::vector<Bracket> stack;
+    double fa = point(a);
+    double fb = point(b);
+    stack.push_back({a, b, fa, fb, false, false});
+
+    while (!stack.empty()) {
+        if (opts.cancel && opts.cancel->load(std::memory_order_relaxed)) {
+            out.cancelled = true;
+            break;
+        }
+        Bracket box = stack.back();
+        stack.pop_back();
+
+        out.boxes++;
+        Interval x(box.lo, box.hi);
+        Interval slope;
+        Interval range = f.evaluate(x, slope);
+
+        // The mean value form f(m) + f'(x) (x - m) is much tighter than the
+        // plain enclosure on narrow boxes, where x appears many times
+        double mid = box.lo + 0.5 * (box.hi - box.lo);
+        if (range.contains(0.0) && std::isfinite(slope.lo) && std::isfinite(slope.hi)) {
+            Interval meanValue = f.evaluate(Interval(mid)) + slope * (x - Interval(mid));
+            range.lo = std::max(range.lo, meanValue.lo);
+            range.hi = std::min(range.hi, meanValue.hi);
+        }
+        if (range.isEmpty() || !range.contains(0.0)) {
+            out.pruned++;
+            continue;
+        }
+
+        // Monotonic with finite ends: one root if the ends differ in sign,
+        // none otherwise
+        box.signChange = signsDiffer(box.flo, box.fhi);
+        bool monotonic = !slope.isEmpty() && !slope.contains(0.0) &&
+                         std::isfinite(box.flo) && std::isfinite(box.fhi);
+        if (monotonic) {
+            box.unique = true;
+            if (box.signChange) found.push_back(box);
+            else out.pruned++;
+            continue;
+        }
+
+        bool canSplit = box.hi - box.lo > minWidth && mid > box.lo && mid < box.hi &&
+                        out.boxes < opts.maxBoxes;
+        if (!canSplit) {
+            // Nearby undecided leaves are one candidate: around a multiple
+            // root, rounding makes f change sign all over a small cluster,
+            // with gaps where it happens to exclude zero. A leaf joins the
+            // cluster before it if the gap is no wider than the cluster
+            Bracket* last = found.empty() ? nullptr : &found.back();
+            if (last && !last->unique && box.lo - last->hi <= last->hi - last->lo) {
+                last->hi = box.hi;
+                last->fhi = box.fhi;
+                last->signChange = signsDiffer(last->flo, last->fhi);
+            } else {
+                found.push_back(box);
+            }
+            continue;
+        }
+
+        double fmid = point(mid);
+        stack.push_back({mid, box.hi, fmid, box.fhi, false, false});
+        stack.push_back({box.lo, mid, box.flo, fmid, false, false});
+    }
+
+    // Zeros inside a cluster are part of its one candidate
+    for (const Bracket& z : zeros) {
+        bool covered = false;
+        for (const Bracket& br : found)
+            if (!br.unique && br.lo <= z.lo && z.lo <= br.hi) covered = true;
+        if (!covered) found.push_back(z);
+    }
+    std::sort(found.begin(), found.end(), [](const Bracket& l, const Bracket& r) { return l.lo < r.lo; });
+    return out;
+}
+
+std::vector<RootScanner::Root> RootIsolator::solve(const Isolation& isolation,
+                                                   const IsolateOptions& opts) const {
+    RootScanOptions scan;
+    scan.xTol = opts.xTol;
+    scan.fTol = opts.fTol;
+    scan.maxIter = opts.maxIter;
+    scan.cancel = opts.cancel;
+
+    const std::vector<Bracket>& brackets = isolation.brackets;
+    std::vector<RootScanner::Root> solved(brackets.size());
+
+    TaskGroup tasks(pool);
+    for (size_t k = 0; k < brackets.size(); ++k) {
+        const Bracket& br = brackets[k];
+        if (br.lo == br.hi) {
+            solved[k] = {br.lo, 0.0, 0, false};
+            continue;
+        }
+
+        tasks.submit([this, &brackets, &solved, &scan, k] {
+            if (scan.cancel && scan.cancel->load(std::memory_order_relaxed)) {
+                solved[k].evaluations = -1;
+                return;
+            }
+            const Bracket& br = brackets[k];
+            if (br.signChange) {
+                solved[k] = RootScanner::solveBracket(f, br.lo, br.flo, br.hi, br.fhi, scan);
+                // A sign change across a pole converges to the pole: reject it
+                if (!(std::fabs(solved[k].fx) <= std::min(std::fabs(br.flo), std::fabs(br.fhi))))
+                    solved[k].evaluations = -1;
+                return;
+            }
+
+            // No sign change: a double root shows as a minimum of |f|. Take
+            // the middle of the run if f' does not change sign across it
+            solved[k] = RootScanner::polishMinimum(f, br.lo, br.hi, scan);
+            if (solved[k].evaluations < 0) {
+                double x = br.lo + 0.5 * (br.hi - br.lo);
+                double fx = f(x);
+                solved[k] = {x, fx, std::fabs(fx) <= scan.fTol ? 1 : -1, false};
+            }
+        });
+    }
+    tasks.wait();
+
+    // Sorted already; merge roots that landed on the same point
+    std::vector<RootScanner::Root> unique;
+    double mergeTol = std::max(opts.xTol * 1e3, 1e-9);
+    for (const RootScanner::Root& r : solved) {
+        if (r.evaluations < 0) continue;
+        if (!unique.empty() && std::fabs(r.x - unique.back().x) <= mergeTol * std::max(1.0, std::fabs(r.x))) {
+            if (std::fabs(r.fx) < std::fabs(unique.back().fx)) unique.back() = r;
+            continue;
+        }
+        unique.push_back(r);
+    }
+    return unique;
+}
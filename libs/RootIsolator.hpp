@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+#include "CompiledExpression.hpp"
+#include "RootScanner.hpp"
+#include "ThreadPool.hpp"
+
+struct IsolateOptions {
+    double minWidth = 1e-9; // narrowest box split, relative to b - a
+    long maxBoxes = 100000; // interval evaluations before splitting stops
+    double xTol = 1e-12;    // as in RootScanOptions, for refining
+    double fTol = 1e-10;
+    int maxIter = 100;
+    const std::atomic<bool>* cancel = nullptr; // as in RootScanOptions
+};
+
+// Finds every root of f on [a, b] by branch and bound instead of sampling.
+// [a, b] is bisected, and each piece is evaluated in interval arithmetic
+// (CompiledExpression::evaluate(Interval, Interval&)) for enclosures of f
+// and f' over all of it:
+//
+//   - f excludes zero: no root, the piece is dropped whole.
+//   - f' excludes zero: f is monotonic, so the piece holds exactly one root
+//     if its ends differ in sign (it becomes a bracket) and none otherwise.
+//   - neither: the piece is split, down to minWidth.
+//
+// f is also enclosed in mean value form, f(m) + f'(x)(x - m), which is far
+// tighter on narrow pieces where x occurs many times. The brackets are then
+// refined concurrently with RootScanner::solveBracket.
+// On a wide domain this costs a few evaluations per root plus a few per
+// level of bisection, where a grid fine enough to separate the roots costs
+// thousands, and a dropped piece is proof that it holds no root rather
+// than a sampling guess. Pieces still undecided at minWidth (multiple
+// roots, tangencies, poles) are merged with their undecided neighbours and
+// solved as a bracket if the run changes sign; otherwise they are refined
+// like RootScanner's minima and kept if |f| <= fTol.
+class RootIsolator {
+public:
+    struct Bracket {
+        double lo, hi;
+        double flo, fhi;
+        bool signChange;
+        bool unique; // f is monotonic on it, or lo == hi and f(lo) == 0
+    };
+
+    struct Isolation {
+        std::vector<Bracket> brackets; // sorted by lo, disjoint
+        long boxes = 0;                // interval evaluations
+        long pruned = 0;               // boxes shown to hold no root
+        long evaluations = 0;          // point evaluations of f at box ends
+        bool cancelled = false;        // stopped by opts.cancel: incomplete
+    };
+
+    RootIsolator(const CompiledExpression& f, ThreadPool& pool);
+
+    Isolation isolate(double a, double b, const IsolateOptions& opts = IsolateOptions()) const;
+
+    // Refines every bracket on the pool. Roots sorted by x, duplicates merged.
+    std::vector<RootScanner::Root> solve(const Isolation& isolation,
+                                         const IsolateOptions& opts = IsolateOptions()) const;
+
+    std::vector<RootScanner::Root> findAll(double a, double b,
+                                           const IsolateOptions& opts = IsolateOptions()) const {
+        return solve(isolate(a, b, opts), opts);
+    }
+
+private:
+    const CompiledExpression& f;
+    ThreadPool& pool;
+};
@@ -0,0 +1,160 @@
+#include "RootScanner.hpp"
+#include "Instrument.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace {
+
+// Grid points evaluated per pool task.
+const size_t kSampleChunk = 4096;
+
+bool sameSign(double a, double b) { return (a < 0) == (b < 0); }
+
+bool cancelled(const RootScanOptions& opts) {
+    return opts.cancel && opts.cancel->load(std::memory_order_relaxed);
+}
+
+} // namespace
+
+RootScanner::RootScanner(const CompiledExpression& f, ThreadPool& pool)
+    : f(f), pool(pool) {}
+
+// Shared by solveBracket and polishMinimum, which applies it to f'(x).
+template <typename F>
+RootScanner::Root bracketSecant(F&& fn, double a, double fa, double b, double fb,
+                                const RootScanOptions& opts) {
+    int evals = 0;
+    double xPrev = a, fPrev = fa; // last two iterates, for the secant step
+    double xCur = b, fCur = fb;
+    double widthBefore = std::fabs(b - a);
+
+    for (int it = 0; it < opts.maxIter; ++it) {
+        double lo = std::min(a, b), hi = std::max(a, b);
+        double x = xCur - fCur * (xCur - xPrev) / (fCur - fPrev);
+
+        // Every second step the bracket must have at least halved
+        bool stalled = (it % 2 == 1) && (hi - lo) > 0.5 * widthBefore;
+        if (it % 2 == 1) widthBefore = hi - lo;
+        if (stalled || !(x > lo && x < hi)) x = 0.5 * (lo + hi);
+        INSTR_COUNT(ITERATIONS, 1);
+
+        double fx = fn(x);
+        evals++;
+        if (fx == 0.0) return {x, fx, evals, true};
+
+        double tol = opts.xTol * std::fabs(x) + 4.0 * DBL_MIN;
+        bool converged = std::fabs(x - xCur) <= tol;
+
+        if (sameSign(fx, fa)) { a = x; fa = fx; }
+        else                  { b = x; fb = fx; }
+        xPrev = xCur; fPrev = fCur;
+        xCur = x;     fCur = fx;
+
+        if (converged || std::fabs(b - a) <= 2.0 * tol) break;
+    }
+
+    return std::fabs(fa) < std::fabs(fb) ? RootScanner::Root{a, fa, evals, true}
+                                         : RootScanner::Root{b, fb, evals, true};
+}
+
+RootScanner::Root RootScanner::solveBracket(const CompiledExpression& f,
+                                            double a, double fa, double b, double fb,
+                                            const RootScanOptions& opts) {
+    return bracketSecant(f, a, fa, b, fb, opts);
+}
+
+// A root where f touches zero without changing sign is a stationary point,
+// so solve f'(x) = 0 on (lo, hi) and keep it if |f| is small enough there.
+RootScanner::Root RootScanner::polishMinimum(const CompiledExpression& f, double lo, double hi,
+                                             const RootScanOptions& opts) {
+    auto df = [&f](double x) { double d; f.evaluate(x, d); return d; };
+
+    double dlo = df(lo), dhi = df(hi);
+    Root r{lo, NAN, -1, false};
+    if (!std::isfinite(dlo) || !std::isfinite(dhi) || sameSign(dlo, dhi))
+        return r;
+
+    Root stationary = bracketSecant(df, lo, dlo, hi, dhi, opts);
+    double fx = f(stationary.x);
+    if (std::fabs(fx) <= opts.fTol)
+        r = {stationary.x, fx, stationary.evaluations + 3, false};
+    return r;
+}
+
+std::vector<RootScanner::Root> RootScanner::findAll(double a, double b,
+                                                    const RootScanOptions& opts) const {
+    if (a > b) std::swap(a, b);
+    const size_t n = size_t(std::max(opts.samples, 2));
+
+    // 1. Sample the grid, chunked across the pool
+    std::vector<double> xs(n), ys(n);
+    for (size_t i = 0; i < n; ++i)
+        xs[i] = a + (b - a) * double(i) / double(n - 1);
+
+    TaskGroup tasks(pool); // the pool may be running other callers' work too
+    for (size_t start = 0; start < n; start += kSampleChunk) {
+        size_t count = std::min(kSampleChunk, n - start);
+        tasks.submit([this, &xs, &ys, &opts, start, count] {
+            if (cancelled(opts)) return;
+            f.evaluate(&xs[start], &ys[start], count);
+        });
+    }
+    tasks.wait();
+    if (cancelled(opts)) return std::vector<Root>();
+
+    // 2. Exact zeros, sign changes and local minima of |f| become candidates
+    std::vector<Root> exact;
+    std::vector<size_t> brackets, minima;
+    for (size_t i = 0; i < n; ++i) {
+        if (!std::isfinite(ys[i])) continue;
+        if (ys[i] == 0.0) { exact.push_back({xs[i], 0.0, 0, true}); continue; }
+
+        if (i + 1 < n && std::isfinite(ys[i + 1]) && ys[i + 1] != 0.0 && !sameSign(ys[i], ys[i + 1]))
+            brackets.push_back(i);
+
+        if (i > 0 && i + 1 < n &&
+            std::fabs(ys[i]) < std::fabs(ys[i - 1]) && std::fabs(ys[i]) <= std::fabs(ys[i + 1]) &&
+            sameSign(ys[i - 1], ys[i]) && sameSign(ys[i], ys[i + 1]))
+            minima.push_back(i);
+    }
+
+    // 3. Solve every candidate concurrently; each task owns one result slot
+    std::vector<Root> solved(brackets.size() + minima.size());
+    for (size_t k = 0; k < brackets.size(); ++k) {
+        size_t i = brackets[k];
+        tasks.submit([this, &xs, &ys, &solved, &opts, i, k] {
+            if (cancelled(opts)) { solved[k].evaluations = -1; return; }
+            solved[k] = solveBracket(f, xs[i], ys[i], xs[i + 1], ys[i + 1], opts);
+            // A sign change across a pole converges to the pole: reject it
+            if (!(std::fabs(solved[k].fx) <= std::min(std::fabs(ys[i]), std::fabs(ys[i + 1]))))
+                solved[k].evaluations = -1;
+        });
+    }
+    for (size_t k = 0; k < minima.size(); ++k) {
+        size_t i = minima[k];
+        size_t slot = brackets.size() + k;
+        tasks.submit([this, &xs, &solved, &opts, i, slot] {
+            if (cancelled(opts)) { solved[slot].evaluations = -1; return; }
+            solved[slot] = polishMinimum(f, xs[i - 1], xs[i + 1], opts);
+        });
+    }
+    tasks.wait();
+
+    // 4. Sort and merge roots that landed on the same point
+    std::vector<Root> roots = exact;
+    for (const Root& r : solved)
+        if (r.evaluations >= 0) roots.push_back(r);
+    std::sort(roots.begin(), roots.end(), [](const Root& l, const Root& r) { return l.x < r.x; });
+
+    std::vector<Root> unique;
+    double mergeTol = std::max(opts.xTol * 1e3, 1e-9);
+    for (const Root& r : roots) {
+        if (!unique.empty() && std::fabs(r.x - unique.back().x) <= mergeTol * std::max(1.0, std::fabs(r.x))) {
+            if (std::fabs(r.fx) < std::fabs(unique.back().fx)) unique.back() = r;
+            continue;
+        }
+        unique.push_back(r);
+    }
+    return unique;
+}
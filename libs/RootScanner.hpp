@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include "CompiledExpression.hpp"
+#include "ThreadPool.hpp"
+
+struct RootScanOptions {
+    int samples = 1000;  // grid points over [a, b]
+    double xTol = 1e-12; // relative width at which a bracket counts as solved
+    double fTol = 1e-10; // |f| accepted for roots found without a sign change
+    int maxIter = 100;   // per-root iteration limit
+
+    // Checked between pieces of work (e.g. a GUI's cancel button); once it
+    // reads true the search returns early with the roots solved so far
+    const std::atomic<bool>* cancel = nullptr;
+};
+
+// Finds every root of f on [a, b]: samples f on a grid, turns sign changes
+// into brackets and local minima of |f| into candidates for even-multiplicity
+// roots, solves all of them concurrently on a thread pool and merges
+// duplicates.
+class RootScanner {
+public:
+    struct Root {
+        double x, fx;
+        int evaluations; // spent refining this root, grid not included
+        bool bracketed;  // false for roots found from a minimum of |f|
+    };
+
+    RootScanner(const CompiledExpression& f, ThreadPool& pool);
+
+    // Roots sorted by x.
+    std::vector<Root> findAll(double a, double b, const RootScanOptions& opts = RootScanOptions()) const;
+
+    // Safeguarded secant on a bracket with fa, fb of opposite sign: takes the
+    // secant step through the last two iterates unless it leaves the bracket
+    // or the bracket stops shrinking, in which case it bisects.
+    static Root solveBracket(const CompiledExpression& f, double a, double fa, double b, double fb,
+                             const RootScanOptions& opts);
+
+    // A root on (lo, hi) where f touches zero without changing sign: solves
+    // f'(x) = 0 there and keeps the point if |f| <= opts.fTol. Returns a
+    // root with evaluations < 0 if there is none.
+    static Root polishMinimum(const CompiledExpression& f, double lo, double hi,
+                              const RootScanOptions& opts);
+
+private:
+    const CompiledExpression& f;
+    ThreadPool& pool;
+};
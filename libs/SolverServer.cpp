@@ -0,0 +1,291 @@
+#include "SolverServer.hpp"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <poll.h>
+#include <stdexcept>
+#include <streambuf>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+namespace {
+
+// A client that goes away mid-answer must not kill the server with SIGPIPE.
+#ifdef MSG_NOSIGNAL
+const int kSendFlags = MSG_NOSIGNAL;
+#else
+const int kSendFlags = 0; // SO_NOSIGPIPE is set on the socket instead
+#endif
+
+std::runtime_error systemError(const std::string& what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+// Answers waiting for a client that is not reading them: past this the
+// connection stops reading jobs, and once none has been taken for
+// kSendTimeoutMs the client is dropped.
+const size_t kMaxBacklog = 1 << 20;
+const int kSendTimeoutMs = 10000;
+
+// Buffered stream over a connected socket. Writing happens on pool threads
+// under BatchSolver's output lock, so it never touches the socket: a
+// client that stops reading must not hold up the pool. Written data is
+// queued, and sent without blocking by the connection's own thread while
+// it waits for input (underflow) or once the jobs are done (drain).
+class SocketBuf : public std::streambuf {
+public:
+    explicit SocketBuf(int fd) : fd(fd) {
+        if (::pipe(wake) != 0) throw systemError("pipe");
+        ::fcntl(wake[0], F_SETFL, O_NONBLOCK);
+        ::fcntl(wake[1], F_SETFL, O_NONBLOCK);
+        setg(in, in, in);
+        setp(out, out + sizeof out);
+    }
+    ~SocketBuf() override {
+        ::close(wake[0]);
+        ::close(wake[1]);
+    }
+
+    // Sends everything written so far. Returns false if the client was
+    // dropped instead.
+    bool drain() { return pump(false); }
+
+protected:
+    int_type underflow() override {
+        if (!pump(true)) return traits_type::eof();
+        ssize_t n;
+        do n = ::read(fd, in, sizeof in); while (n < 0 && errno == EINTR);
+        if (n <= 0) return traits_type::eof();
+        setg(in, in, in + n);
+        return traits_type::to_int_type(in[0]);
+    }
+
+    int_type overflow(int_type c) override {
+        sync();
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    int sync() override {
+        if (pptr() == pbase()) return 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!dropped) queued.append(pbase(), pptr());
+        }
+        setp(out, out + sizeof out);
+        char c = 1;
+        ssize_t n = ::write(wake[1], &c, 1); // a full pipe is awake anyway
+        (void)n;
+        return 0;
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    // Connection thread: sends queued output while waiting until the socket
+    // is readable (forInput) or nothing is left to send. Input is not
+    // waited for while the backlog is over kMaxBacklog. Returns false once
+    // the client is dropped.
+    bool pump(bool forInput) {
+        for (;;) {
+            size_t backlog;
+            if (!sendSome(backlog)) return false;
+            if (!forInput && backlog == 0) return true;
+
+            bool reading = forInput && backlog < kMaxBacklog;
+            int timeout = -1;
+            if (backlog > 0) {
+                long idle = long(std::chrono::duration_cast<std::chrono::milliseconds>(
+                    Clock::now() - lastSent).count());
+                if (idle >= kSendTimeoutMs) {
+                    drop();
+                    return false;
+                }
+                timeout = int(kSendTimeoutMs - idle);
+            }
+
+            short events = short((reading ? POLLIN : 0) | (backlog > 0 ? POLLOUT : 0));
+            pollfd fds[2] = {{fd, events, 0}, {wake[0], POLLIN, 0}};
+            if (::poll(fds, 2, timeout) < 0 && errno != EINTR) {
+                drop();
+                return false;
+            }
+            if (fds[1].revents) {
+                char buf[64];
+                while (::read(wake[0], buf, sizeof buf) > 0) {}
+            }
+            if (reading && (fds[0].revents & (POLLIN | POLLHUP | POLLERR))) return true;
+        }
+    }
+
+    // Sends what the socket takes without blocking; backlog is what is left.
+    bool sendSome(size_t& backlog) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (dropped) return false;
+            if (sent == sending.size() && !queued.empty()) {
+                // The client has taken everything before: its time starts now
+                sending.clear();
+                sending.swap(queued);
+                sent = 0;
+                lastSent = Clock::now();
+            }
+            backlog = sending.size() - sent + queued.size();
+        }
+        while (sent < sending.size()) {
+            ssize_t n = ::send(fd, sending.data() + sent, sending.size() - sent, kSendFlags | MSG_DONTWAIT);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            if (n <= 0) { // the client is gone: drop the rest
+                drop();
+                return false;
+            }
+            sent += size_t(n);
+            backlog -= size_t(n);
+            lastSent = Clock::now();
+        }
+        return true;
+    }
+
+    void drop() {
+        std::lock_guard<std::mutex> lock(mutex);
+        dropped = true;
+        queued.clear();
+        sending.clear();
+        sent = 0;
+    }
+
+    int fd;
+    int wake[2]; // sync() writes to wake[1]
+    std::mutex mutex;
+    std::string queued;  // written, not yet taken by the connection thread
+    bool dropped = false;
+    std::string sending; // being sent, connection thread only
+    size_t sent = 0;
+    Clock::time_point lastSent;
+    char in[1 << 16];
+    char out[1 << 16];
+};
+
+} // namespace
+
+SolverServer::SolverServer(BatchSolver& batch, const std::string& path)
+    : batch(batch), path(path) {
+    if (::pipe(wake) != 0) throw systemError("pipe");
+    ::fcntl(wake[1], F_SETFL, O_NONBLOCK); // stop() must never block
+}
+
+SolverServer::~SolverServer() {
+    if (listenFd >= 0) ::close(listenFd);
+    ::close(wake[0]);
+    ::close(wake[1]);
+}
+
+void SolverServer::stop() {
+    char c = 1;
+    ssize_t n = ::write(wake[1], &c, 1);
+    (void)n;
+}
+
+void SolverServer::run() {
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof addr.sun_path)
+        throw std::runtime_error("Bad socket path: " + path);
+    std::memcpy(addr.sun_path, path.c_str(), path.size());
+
+    // A socket file nobody answers on is left over from a server that died;
+    // anything else at the path is not ours to remove
+    int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe < 0) throw systemError("socket");
+    if (::connect(probe, (sockaddr*)&addr, sizeof addr) == 0) {
+        ::close(probe);
+        throw std::runtime_error("A server is already listening on " + path);
+    }
+    if (errno == ECONNREFUSED) ::unlink(path.c_str());
+    ::close(probe);
+
+    listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) throw systemError("socket");
+    if (::bind(listenFd, (sockaddr*)&addr, sizeof addr) != 0) throw systemError("bind " + path);
+    ::chmod(path.c_str(), S_IRUSR | S_IWUSR);
+    if (::listen(listenFd, SOMAXCONN) != 0) throw systemError("listen");
+
+    for (;;) {
+        pollfd fds[2] = {{listenFd, POLLIN, 0}, {wake[0], POLLIN, 0}};
+        if (::poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[1].revents) break;
+        if (!(fds[0].revents & POLLIN)) continue;
+
+        int fd = ::accept(listenFd, nullptr, nullptr);
+        if (fd < 0) continue;
+#ifdef SO_NOSIGPIPE
+        int one = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof one);
+#endif
+
+        reap(false);
+        std::lock_guard<std::mutex> lock(connMutex);
+        open.emplace_back();
+        Connection& c = open.back();
+        c.fd = fd;
+        c.reader = std::thread(&SolverServer::serve, this, std::ref(c));
+        served++;
+    }
+
+    ::close(listenFd);
+    listenFd = -1;
+    ::unlink(path.c_str());
+
+    // Connections stop reading; the jobs they have read are still answered
+    {
+        std::lock_guard<std::mutex> lock(connMutex);
+        for (Connection& c : open)
+            if (!c.done) ::shutdown(c.fd, SHUT_RD);
+    }
+    reap(true);
+}
+
+void SolverServer::serve(Connection& c) {
+    try {
+        std::unique_ptr<SocketBuf> buf(new SocketBuf(c.fd));
+        std::istream in(buf.get());
+        std::ostream out(buf.get());
+
+        jobCount += batch.run(in, out);
+        out.flush();
+        buf->drain();
+    } catch (const std::exception&) {
+        // Out of descriptors for the wake pipe: the client is hung up on
+    }
+
+    // The client sees end of file now; the descriptor itself is closed by
+    // reap(), as closing it here could race stop()'s shutdown()
+    ::shutdown(c.fd, SHUT_RDWR);
+    c.done = true;
+}
+
+void SolverServer::reap(bool all) {
+    std::lock_guard<std::mutex> lock(connMutex);
+    for (auto it = open.begin(); it != open.end();) {
+        if (all || it->done) {
+            it->reader.join();
+            ::close(it->fd);
+            it = open.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
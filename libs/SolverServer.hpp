@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstdlib>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include "BatchSolver.hpp"
+
+// Long-running solver process that serves BatchSolver's line protocol on a
+// Unix domain socket, so many small requests pay neither process startup
+// nor parsing: the pool stays up and the expression cache stays warm
+// across connections.
+//
+// Each connection is read on a thread of its own and runs its jobs on the
+// shared pool; a client may pipeline as many lines as it likes and reads
+// the answers as they finish (matched by line number or "id", since they
+// can come back out of order). Shutting down its writing side tells the
+// server the client is done; the server answers what is in flight and
+// closes. The socket is made accessible to its owner only.
+//
+// Answers are sent by the connection's own thread, never by the pool, so a
+// client that does not read them holds up only itself: once a megabyte of
+// answers is waiting its jobs are no longer read, and once it has taken
+// none of them for ten seconds it is dropped.
+class SolverServer {
+public:
+    SolverServer(BatchSolver& batch, const std::string& path);
+    ~SolverServer();
+
+    SolverServer(const SolverServer&) = delete;
+    SolverServer& operator=(const SolverServer&) = delete;
+
+    // Binds the socket (replacing a stale one, but not a live server's)
+    // and serves until stop(). Throws std::runtime_error if it cannot bind.
+    void run();
+
+    // Makes run() stop accepting, finish the jobs already read and return.
+    // Async-signal-safe, so a SIGINT handler may call it.
+    void stop();
+
+    long connections() const { return served.load(); }
+    long jobs() const { return jobCount.load(); }
+
+    // $SECANT_SOCKET if set, otherwise /tmp/secant-<uid>.sock. Shared with
+    // the client, which needs nothing else from here.
+    static std::string defaultPath() {
+        const char* env = std::getenv("SECANT_SOCKET");
+        if (env && *env) return env;
+        return "/tmp/secant-" + std::to_string(getuid()) + ".sock";
+    }
+
+private:
+    struct Connection {
+        int fd;
+        std::thread reader;
+        std::atomic<bool> done{false};
+    };
+
+    void serve(Connection& c);
+    void reap(bool all);
+
+    BatchSolver& batch;
+    std::string path;
+    int listenFd = -1;
+    int wake[2] = {-1, -1}; // stop() writes to wake[1]
+
+    std::mutex connMutex;
+    std::list<Connection> open;
+    std::atomic<long> served{0};
+    std::atomic<long> jobCount{0};
+};
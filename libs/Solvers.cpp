@@ -0,0 +1,349 @@
+#include "Solvers.hpp"
+#include "Instrument.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace {
+
+// Without a bracket: how much longer than the previous step a step may be,
+// and how many steps |f| may go without improving.
+const double kMaxGrowth = 10.0;
+const int kMaxStall = 10;
+
+const char* const kMethodNames[RootSolver::kMethods] = {
+    "secant", "brent", "illinois", "anderson-bjorck", "steffensen"
+};
+
+bool sameSign(double a, double b) { return (a < 0) == (b < 0); }
+
+} // namespace
+
+NewtonSolver::NewtonSolver(const CompiledExpression& f, double x0)
+    : f(f), x(x0) {}
+
+bool NewtonSolver::step(Step& out) {
+    INSTR_SCOPE(NEWTON_STEP);
+    INSTR_COUNT(ITERATIONS, 1);
+
+    double dfx;
+    double fx = f.evaluate(x, dfx);
+    evalCount++;
+
+    if (dfx == 0.0 || !std::isfinite(dfx))
+        return false;
+
+    double xNext = x - fx / dfx;
+    out = {iteration, x, fx, dfx, xNext, std::fabs((xNext - x) / xNext)};
+
+    x = xNext;
+    iteration++;
+    return true;
+}
+
+RootSolver::RootSolver(const CompiledExpression& f, Method method, double x1, double x2,
+                       const SolveOptions& opts, EvalMemo* memo)
+    : f(f), method(method), opts(opts), memo(memo) {
+    if (x1 == x2) x2 = x1 + 1e-3 * std::max(std::fabs(x1), 1.0);
+
+    xPrev = x1; fPrev = eval(x1);
+    xCur = x2;  fCur = eval(x2);
+    fScale = std::max(std::fabs(fPrev), std::fabs(fCur));
+
+    if (std::fabs(fPrev) < std::fabs(fCur)) { bestX = xPrev; bestF = fPrev; }
+    else                                    { bestX = xCur;  bestF = fCur; }
+
+    if (!std::isfinite(fPrev) || !std::isfinite(fCur))
+        state = NOT_FINITE;
+    else if (std::fabs(bestF) <= opts.fAbsTol + opts.fRelTol * fScale)
+        state = CONVERGED;
+    else if (!sameSign(fPrev, fCur))
+        setBracket(xPrev, fPrev, xCur, fCur);
+}
+
+double RootSolver::eval(double x) {
+    if (!memo) {
+        evalCount++;
+        return f(x);
+    }
+
+    bool evaluated;
+    double fx = (*memo)(x, evaluated);
+    if (evaluated) evalCount++;
+    return fx;
+}
+
+double RootSolver::xTol(double x) const {
+    return opts.xAbsTol + opts.xRelTol * std::fabs(x);
+}
+
+// u is the older point, v the newer one.
+void RootSolver::setBracket(double u, double fu, double v, double fv) {
+    haveBracket = true;
+    a = u; fa = fu;
+    b = v; fb = fv;
+    // The first two steps only have to stay inside
+    lastStep = stepBefore = 2.0 * std::fabs(b - a);
+
+    // Brent keeps the end with the smaller |f| in b
+    c = a; fc = fa;
+    d = e = b - a;
+    if (method == BRENT && std::fabs(fa) < std::fabs(fb)) {
+        std::swap(a, b);
+        std::swap(fa, fb);
+        c = a; fc = fa;
+    }
+}
+
+// Secant step through the last two iterates, limited in length; a flat
+// secant widens the search instead.
+double RootSolver::searchStep() const {
+    double h = xCur - xPrev;
+    if (fCur == fPrev) return xCur + 2.0 * h;
+
+    double x = xCur - fCur * h / (fCur - fPrev);
+    double limit = kMaxGrowth * std::fabs(h);
+    if (std::fabs(x - xCur) > limit) x = xCur + std::copysign(limit, x - xCur);
+    return x;
+}
+
+// Inside a bracket: bisect unless x is inside it and the step to x is less
+// than half the step before last (the same rule Brent's method applies to
+// its interpolation), so the iterates cannot creep along.
+double RootSolver::safeguard(double x) {
+    double lo = std::min(a, b), hi = std::max(a, b);
+    double len = std::fabs(x - xCur);
+
+    if (!(x >= lo && x <= hi && len < 0.5 * stepBefore)) {
+        x = 0.5 * (lo + hi);
+        len = 0.5 * (hi - lo);
+    }
+    stepBefore = lastStep;
+    lastStep = len;
+    return x;
+}
+
+// One step of Brent's method (Brent 1973, as in zeroin), evaluating f once.
+// On return b is the best end again and [b, a] the bracket.
+double RootSolver::brentStep(double& fx) {
+    double tol1 = 2.0 * DBL_EPSILON * std::fabs(b) + 0.5 * xTol(b);
+    double xm = 0.5 * (a - b);
+
+    if (std::fabs(e) >= tol1 && std::fabs(fc) > std::fabs(fb)) {
+        // Inverse quadratic interpolation through a, b, c, or secant
+        // through b, c when c is the other end
+        double p, q, s = fb / fc;
+        if (c == a) {
+            p = 2.0 * xm * s;
+            q = 1.0 - s;
+        } else {
+            double qa = fc / fa, r = fb / fa;
+            p = s * (2.0 * xm * qa * (qa - r) - (b - c) * (r - 1.0));
+            q = (qa - 1.0) * (r - 1.0) * (s - 1.0);
+        }
+        if (p > 0.0) q = -q;
+        else p = -p;
+
+        // Accept it only if it stays well inside the bracket and shrinks
+        // faster than the step before last; otherwise bisect
+        if (2.0 * p < std::min(3.0 * xm * q - std::fabs(tol1 * q), std::fabs(e * q))) {
+            e = d;
+            d = p / q;
+        } else {
+            d = xm;
+            e = d;
+        }
+    } else {
+        d = xm;
+        e = d;
+    }
+
+    c = b; fc = fb;
+    b += std::fabs(d) > tol1 ? d : std::copysign(tol1, xm);
+    fb = eval(b);
+    double x = b;
+    fx = fb;
+
+    if (sameSign(fb, fa)) {
+        a = c; fa = fc;
+        d = e = b - c;
+    }
+    if (std::fabs(fa) < std::fabs(fb)) {
+        c = b; b = a; a = c;
+        fc = fb; fb = fa; fa = fc;
+    }
+    return x;
+}
+
+// One step of regula falsi on [a, b], b being the newest end. An end kept
+// for a second step has its f scaled down so the next step moves it.
+double RootSolver::falsiStep(double& fx) {
+    double x = b - fb * (b - a) / (fb - fa);
+    double lo = std::min(a, b), hi = std::max(a, b);
+    if (!(x > lo && x < hi)) {
+        // Once f at one end is tiny next to the other the interpolant rounds
+        // onto that end. Step a tolerance in from it, as Brent's method
+        // does, so the bracket closes there instead of being halved
+        double tol = 2.0 * DBL_EPSILON * std::fabs(b) + 0.5 * xTol(b);
+        if (hi - lo > 2.0 * tol && x >= hi)      x = hi - tol;
+        else if (hi - lo > 2.0 * tol && x <= lo) x = lo + tol;
+        else                                     x = 0.5 * (lo + hi);
+    }
+
+    fx = eval(x);
+    if (std::isfinite(fx)) {
+        if (sameSign(fx, fb)) {
+            double m = 0.5;
+            if (method == ANDERSON_BJORCK && 1.0 - fx / fb > 0.0) m = 1.0 - fx / fb;
+            fa *= m;
+        } else {
+            a = b; fa = fb;
+        }
+        b = x; fb = fx;
+    }
+    return x;
+}
+
+// Steffensen: a divided difference over h = f(x), which tends to the
+// derivative as fast as x tends to the root. |h| is capped at the last step
+// so a large f far from the root cannot throw the second point away.
+double RootSolver::steffensenStep() {
+    double cap = std::fabs(xCur - xPrev);
+    double h = std::fabs(fCur) < cap ? fCur : std::copysign(cap, fCur);
+    double xh = xCur + h;
+    double fh = eval(xh);
+
+    double x;
+    if (!std::isfinite(fh)) {
+        x = searchStep();
+    } else {
+        if (haveBracket) {
+            if (xh > std::min(a, b) && xh < std::max(a, b)) {
+                if (sameSign(fh, fa)) { a = xh; fa = fh; }
+                else                  { b = xh; fb = fh; }
+            }
+        } else if (!sameSign(fh, fCur)) {
+            setBracket(xCur, fCur, xh, fh);
+        }
+        if (std::fabs(fh) < std::fabs(bestF)) { bestX = xh; bestF = fh; }
+
+        if (fh == fCur) {
+            x = searchStep();
+        } else {
+            x = xCur - fCur * h / (fh - fCur);
+            double limit = kMaxGrowth * std::max(cap, std::fabs(h));
+            if (!haveBracket && std::fabs(x - xCur) > limit)
+                x = xCur + std::copysign(limit, x - xCur);
+        }
+    }
+    return haveBracket ? safeguard(x) : x;
+}
+
+bool RootSolver::step(Step& out) {
+    if (state != RUNNING) return false;
+    INSTR_SCOPE(ROOT_STEP);
+    INSTR_COUNT(ITERATIONS, 1);
+
+    out.n = iteration;
+    if (haveBracket) { out.a = a; out.fa = fa; out.b = b; out.fb = fb; }
+    else             { out.a = xPrev; out.fa = fPrev; out.b = xCur; out.fb = fCur; }
+
+    // BRENT and the regula falsi methods update their bracket themselves
+    bool ownBracket = haveBracket && method != SECANT && method != STEFFENSEN;
+
+    double x, fx;
+    if (method == STEFFENSEN) {
+        x = steffensenStep();
+        fx = eval(x);
+    } else if (!haveBracket) {
+        x = searchStep();
+        fx = eval(x);
+    } else if (method == BRENT) {
+        x = brentStep(fx);
+    } else if (method == SECANT) {
+        double secant = fCur != fPrev ? xCur - fCur * (xCur - xPrev) / (fCur - fPrev) : NAN;
+        x = safeguard(secant);
+        fx = eval(x);
+    } else {
+        x = falsiStep(fx);
+    }
+
+    double dx = std::fabs(x - xCur);
+    out.x = x;
+    out.fx = fx;
+    out.dx = dx;
+    iteration++;
+
+    if (!std::isfinite(fx)) {
+        out.bracketed = haveBracket;
+        // Landing on the pole of a bracketed sign change is the same outcome
+        // as closing the bracket on it, whichever method got there
+        state = haveBracket && std::isinf(fx) ? SINGULAR : NOT_FINITE;
+        return true;
+    }
+
+    if (!ownBracket) {
+        if (haveBracket) {
+            if (sameSign(fx, fa)) { a = x; fa = fx; }
+            else                  { b = x; fb = fx; }
+        } else if (!sameSign(fx, fCur)) {
+            setBracket(xCur, fCur, x, fx);
+        }
+    }
+    out.bracketed = haveBracket;
+
+    xPrev = xCur; fPrev = fCur;
+    xCur = x;     fCur = fx;
+
+    if (std::fabs(fx) < std::fabs(bestF)) {
+        bestX = x;
+        bestF = fx;
+        stall = 0;
+    } else {
+        stall++;
+    }
+
+    double tol = std::max(xTol(x), 2.0 * DBL_EPSILON * std::fabs(x));
+    if (std::fabs(fx) <= opts.fAbsTol + opts.fRelTol * fScale)
+        state = CONVERGED;
+    else if (dx <= tol || (haveBracket && std::fabs(b - a) <= 2.0 * tol))
+        // A pole closes a bracket too, but |f| grows instead of shrinking
+        state = std::fabs(fx) <= fScale ? CONVERGED : SINGULAR;
+    else if (!haveBracket && stall >= kMaxStall)
+        state = DIVERGED;
+    else if (iteration >= opts.maxIter)
+        state = MAX_ITERATIONS;
+    return true;
+}
+
+RootSolver::Status RootSolver::solve() {
+    Step s;
+    while (step(s)) {}
+    return state;
+}
+
+const char* RootSolver::methodName(Method m) {
+    return kMethodNames[m];
+}
+
+const char* RootSolver::statusName(Status s) {
+    switch (s) {
+        case RUNNING:        return "running";
+        case CONVERGED:      return "converged";
+        case MAX_ITERATIONS: return "iteration limit reached";
+        case DIVERGED:       return "diverged";
+        case NOT_FINITE:     return "f(x) not finite";
+        case SINGULAR:       return "singular (sign change without a root)";
+    }
+    return "";
+}
+
+bool RootSolver::parseMethod(const std::string& name, Method& m) {
+    for (int i = 0; i < kMethods; ++i) {
+        if (name == kMethodNames[i]) {
+            m = Method(i);
+            return true;
+        }
+    }
+    return false;
+}
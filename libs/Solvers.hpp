@@ -0,0 +1,155 @@
+#pragma once
+
+#include <string>
+#include "CompiledExpression.hpp"
+#include "EvalMemo.hpp"
+
+// Newton–Raphson iteration x' = x - f(x)/f'(x) on a compiled expression.
+// f and f' come from one forward-mode pass (CompiledExpression::evaluate
+// with a derivative), so each step costs a single evaluation.
+class NewtonSolver {
+public:
+    struct Step {
+        int n;
+        double x, fx, dfx; // current point
+        double xNext;      // x - fx/dfx
+        double err;        // |(xNext - x) / xNext|
+    };
+
+    NewtonSolver(const CompiledExpression& f, double x0);
+
+    // Performs one iteration. Returns false, leaving the solver unchanged, if
+    // f'(x) is zero or not finite.
+    bool step(Step& out);
+
+    double current() const { return x; }
+    int evaluations() const { return evalCount; }
+
+private:
+    const CompiledExpression& f;
+    double x;
+    int iteration = 0;
+    int evalCount = 0;
+};
+
+// Stopping rule shared by every RootSolver method. An iterate x is accepted
+// when |f(x)| <= fAbsTol + fRelTol * f0, f0 being the larger |f| at the two
+// starting points, or when the last step or the bracket is no wider than
+// xAbsTol + xRelTol * |x|. The absolute term on x is what lets roots at or
+// near zero converge; a purely relative error never gets small there.
+struct SolveOptions {
+    double xAbsTol = 1e-12;
+    double xRelTol = 1e-12;
+    double fAbsTol = 0.0;
+    double fRelTol = 0.0;
+    int maxIter = 100;
+};
+
+// Derivative-free root finding from two starting points, one interface for
+// several methods:
+//
+//   SECANT           secant steps
+//   BRENT            Brent's method: inverse quadratic interpolation and
+//                    secant steps, falling back to bisection
+//   ILLINOIS         regula falsi, halving f at an end that is kept twice
+//   ANDERSON_BJORCK  regula falsi with the Anderson-Bjorck scaling instead
+//   STEFFENSEN       Steffensen's method (Aitken-accelerated), two
+//                    evaluations per step but quadratic convergence
+//
+// Until two iterates have f of opposite sign every method takes secant
+// (Steffensen: its own) steps, limited to ten times the previous step, and a
+// flat secant widens the search instead of failing. Once there is a sign
+// change the solver keeps the bracket: BRENT, ILLINOIS and ANDERSON_BJORCK
+// switch to their bracketed iteration, and SECANT and STEFFENSEN bisect
+// whenever a step would leave the bracket or is not less than half the step
+// before last, so a bracketed run cannot diverge. An unbracketed run stops
+// as DIVERGED once |f| has not improved for ten steps.
+class RootSolver {
+public:
+    enum Method {
+        SECANT,
+        BRENT,
+        ILLINOIS,
+        ANDERSON_BJORCK,
+        STEFFENSEN,
+        kMethods
+    };
+
+    enum Status {
+        RUNNING,
+        CONVERGED,
+        MAX_ITERATIONS,
+        DIVERGED,   // no bracket and |f| stopped improving
+        NOT_FINITE, // f is NaN or infinite at an iterate
+        SINGULAR    // the bracket closed on a sign change that is no root,
+                    // such as the pole of 1/x, or f is infinite inside it
+    };
+
+    struct Step {
+        int n;
+        double a, fa; // the bracket once there is one, else the two
+        double b, fb; // iterates the step started from
+        double x, fx; // the new iterate
+        double dx;    // |x - previous iterate|
+        bool bracketed;
+    };
+
+    // With a memo (which must be attached to f), points it has already seen
+    // are not evaluated again and do not count towards evaluations().
+    // Equal starting points are moved apart.
+    RootSolver(const CompiledExpression& f, Method method, double x1, double x2,
+               const SolveOptions& opts = SolveOptions(), EvalMemo* memo = nullptr);
+
+    // Performs one iteration and updates status(). Returns false, doing
+    // nothing, once the status is no longer RUNNING.
+    bool step(Step& out);
+
+    // Steps until the status is no longer RUNNING and returns it.
+    Status solve();
+
+    Status status() const { return state; }
+    double root() const { return bestX; }  // the iterate with the smallest |f|
+    double value() const { return bestF; } // f(root())
+    int iterations() const { return iteration; }
+    int evaluations() const { return evalCount; }
+    bool bracketed() const { return haveBracket; }
+
+    // Lower-case names ("secant", "brent", "illinois", "anderson-bjorck",
+    // "steffensen"), as accepted by parseMethod.
+    static const char* methodName(Method m);
+    static const char* statusName(Status s);
+    static bool parseMethod(const std::string& name, Method& m);
+
+private:
+    double eval(double x);
+    double xTol(double x) const;
+    void setBracket(double u, double fu, double v, double fv);
+    double searchStep() const;
+    double safeguard(double x);
+    double brentStep(double& fx);
+    double falsiStep(double& fx);
+    double steffensenStep();
+
+    const CompiledExpression& f;
+    Method method;
+    SolveOptions opts;
+    EvalMemo* memo;
+    Status state = RUNNING;
+
+    double xPrev, fPrev; // last two iterates
+    double xCur, fCur;
+    double bestX, bestF;
+    double fScale;
+
+    // Bracket: f(a) and f(b) have opposite signs. For BRENT, b is the best
+    // end, c the previous b, and d, e the last two step lengths; for the
+    // regula falsi methods, b is the newest end.
+    bool haveBracket = false;
+    double a = 0, fa = 0, b = 0, fb = 0;
+    double c = 0, fc = 0, d = 0, e = 0;
+    double lastStep = 0, stepBefore = 0; // for safeguard()
+
+    int iteration = 0;
+    int evalCount = 0;
+    int stall = 0; // steps since |f| last improved
+};
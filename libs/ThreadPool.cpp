@@ -0,0 +1,174 @@
+#include "ThreadPool.hpp"
+#include <chrono>
+
+namespace {
+
+// Identifies the pool and deque of the calling thread, if it is a worker.
+thread_local const ThreadPool* tlsPool = nullptr;
+thread_local unsigned tlsIndex = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(unsigned threads) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+
+    for (unsigned i = 0; i < threads; ++i)
+        queues.emplace_back(new Queue);
+    for (unsigned i = 0; i < threads; ++i)
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (std::thread& t : workers) t.join();
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    unsigned target;
+    {
+        std::lock_guard<std::mutex> lock(m);
+        target = (tlsPool == this) ? tlsIndex : nextQueue++ % size();
+        queued++;
+        pending++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues[target]->m);
+        queues[target]->tasks.push_back(std::move(task));
+    }
+    workAvailable.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(m);
+    allDone.wait(lock, [this] { return pending == 0; });
+
+    if (firstError) {
+        std::exception_ptr e = firstError;
+        firstError = nullptr;
+        std::rethrow_exception(e);
+    }
+}
+
+// Pops from the back of our own deque, else steals from the front of another.
+bool ThreadPool::takeTask(unsigned self, std::function<void()>& task) {
+    for (unsigned k = 0; k < size(); ++k) {
+        unsigned i = (self + k) % size();
+        Queue& q = *queues[i];
+        std::lock_guard<std::mutex> lock(q.m);
+        if (q.tasks.empty()) continue;
+
+        if (i == self) {
+            task = std::move(q.tasks.back());
+            q.tasks.pop_back();
+        } else {
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+        }
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(unsigned self) {
+    tlsPool = this;
+    tlsIndex = self;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m);
+            workAvailable.wait(lock, [this] { return stopping || queued > 0; });
+            if (stopping && queued == 0) return;
+        }
+
+        // queued is raised before the push, so the task may not be visible
+        // yet; just go round again in that case.
+        std::function<void()> task;
+        if (!takeTask(self, task)) {
+            std::this_thread::yield();
+            continue;
+        }
+        runTask(task);
+    }
+}
+
+// Runs a task taken from a deque and updates the counters.
+void ThreadPool::runTask(std::function<void()>& task) {
+    {
+        std::lock_guard<std::mutex> lock(m);
+        queued--;
+    }
+
+    std::exception_ptr error;
+    try {
+        task();
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> lock(m);
+    if (error && !firstError) firstError = error;
+    if (--pending == 0) allDone.notify_all();
+}
+
+bool ThreadPool::runOneHere() {
+    std::function<void()> task;
+    if (!takeTask(tlsIndex, task)) return false;
+    runTask(task);
+    return true;
+}
+
+TaskGroup::~TaskGroup() {
+    try {
+        wait();
+    } catch (...) {
+        // Already reported to whoever called wait(), or nobody asked
+    }
+}
+
+void TaskGroup::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(m);
+        pending++;
+    }
+    pool.submit([this, task = std::move(task)] {
+        std::exception_ptr error;
+        try {
+            task();
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        // Notified under the lock: once wait() sees pending == 0 the group
+        // may be destroyed
+        std::lock_guard<std::mutex> lock(m);
+        if (error && !firstError) firstError = error;
+        if (--pending == 0) done.notify_all();
+    });
+}
+
+void TaskGroup::wait() {
+    std::unique_lock<std::mutex> lock(m);
+    if (tlsPool != &pool) {
+        done.wait(lock, [this] { return pending == 0; });
+    } else {
+        // A worker waiting here would hold up the tasks queued behind it:
+        // it runs them itself, and only sleeps when there are none
+        while (pending > 0) {
+            lock.unlock();
+            bool ran = pool.runOneHere();
+            lock.lock();
+            if (!ran && pending > 0) done.wait_for(lock, std::chrono::milliseconds(1));
+        }
+    }
+
+    if (firstError) {
+        std::exception_ptr e = firstError;
+        firstError = nullptr;
+        std::rethrow_exception(e);
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads with one task deque per worker. A worker runs
+// tasks from the back of its own deque and, when that is empty, steals from
+// the front of the others, so uneven tasks (e.g. root solves that converge
+// at different speeds) still keep every core busy.
+class ThreadPool {
+public:
+    // threads == 0 uses std::thread::hardware_concurrency().
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queues a task. Tasks submitted from a worker go to that worker's deque.
+    void submit(std::function<void()> task);
+
+    // Blocks until every task submitted by anyone has finished, and rethrows
+    // the first exception thrown by a task, if any. Meant for the pool's
+    // owner: code sharing the pool waits for its own tasks with a TaskGroup.
+    // Must not be called from a worker, which would wait for itself.
+    void wait();
+
+    unsigned size() const { return unsigned(workers.size()); }
+
+private:
+    friend class TaskGroup;
+
+    struct Queue {
+        std::mutex m;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void workerLoop(unsigned self);
+    bool takeTask(unsigned self, std::function<void()>& task);
+    void runTask(std::function<void()>& task);
+    bool runOneHere(); // called on a worker: runs a queued task, if any
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex m;                 // guards the counters below
+    std::condition_variable workAvailable;
+    std::condition_variable allDone;
+    size_t queued = 0;            // tasks sitting in some deque
+    size_t pending = 0;           // tasks submitted but not finished
+    unsigned nextQueue = 0;
+    bool stopping = false;
+    std::exception_ptr firstError;
+};
+
+// Tasks submitted to a shared pool that can be waited for on their own, so
+// callers sharing one pool do not wait for each other's work. wait() may be
+// called from a worker of the pool: it runs queued tasks until the group is
+// done instead of blocking the worker.
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool& pool) : pool(pool) {}
+    ~TaskGroup(); // waits, discarding any exception
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void submit(std::function<void()> task);
+
+    // Blocks until every task of this group has finished. Rethrows the first
+    // exception thrown by one of them, if any.
+    void wait();
+
+private:
+    ThreadPool& pool;
+    std::mutex m;
+    std::condition_variable done;
+    size_t pending = 0;
+    std::exception_ptr firstError;
+};
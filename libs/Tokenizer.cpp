@@ -1,20 +1,97 @@
 #include "Tokenizer.hpp"
+#include "ExprGraph.hpp"
+#include "Instrument.hpp"
+#include "Jit.hpp"
+#include <algorithm>
 #include <cctype>
 #include <cmath>
-#include <stack>
+#include <charconv>
 #include <stdexcept>
 
+MathParser::MathParser() : jit(JitCode::available()) {}
+
+void MathParser::setJit(bool enabled) { jit = enabled && JitCode::available(); }
+
+CompiledExpression MathParser::compile(const std::string& expr) {
+    return compile(expr, std::vector<std::string>());
+}
+
+CompiledExpression MathParser::compile(const std::string& expr, const std::vector<std::string>& parameters) {
+    CompiledExpression compiled = compileProgram(expr, parameters);
+
+    if (jit) {
+        INSTR_SCOPE(NATIVE);
+        compiled.nativeCode = JitCode::compile(compiled);
+        if (compiled.nativeCode) compiled.native = compiled.nativeCode->function();
+    }
+    return compiled;
+}
+
+CompiledExpression MathParser::compileProgram(const std::string& expr,
+                                              const std::vector<std::string>& parameters) {
+    const std::vector<Token>* tokens;
+    const std::vector<Token>* rpn;
+    const CompiledExpression* program;
+
+    { INSTR_SCOPE(TOKENIZE); tokens = &tokenize(expr, &parameters); }
+    INSTR_COUNT(TOKENS, tokens->size());
+    { INSTR_SCOPE(TO_RPN); rpn = &toRPN(*tokens); }
+    { INSTR_SCOPE(LOWER); program = &lower(*rpn); }
+
+    INSTR_SCOPE(OPTIMIZE);
+    CompiledExpression compiled = graph.simplify(program->code);
+    if (!polynomials) compiled.poly.clear();
+    compiled.paramNames = parameters;
+    compiled.paramValues.assign(parameters.size(), NAN);
+    return compiled;
+}
+
 double MathParser::evaluate(const std::string& expr, double xValue) {
-    auto tokens = tokenize(expr);
-    auto rpn    = toRPN(tokens);
-    return evalRPN(rpn, xValue);
+    // One evaluation does not pay for native code
+    CompiledExpression compiled = compileProgram(expr, std::vector<std::string>());
+
+    INSTR_SCOPE(EVALUATE);
+    return compiled(xValue);
+}
+
+std::vector<std::string> MathParser::names(const std::string& expr) {
+    std::vector<std::string> found;
+    CompiledExpression::OpCode op;
+
+    for (size_t i = 0; i < expr.size();) {
+        if (!isLetter(expr[i])) { i++; continue; }
+
+        size_t start = i;
+        while (i < expr.size() && isLetter(expr[i])) i++;
+        std::string name = expr.substr(start, i - start);
+
+        if (name != "x" && !functionCode(name, op) &&
+            std::find(found.begin(), found.end(), name) == found.end())
+            found.push_back(name);
+    }
+    return found;
 }
 
 bool MathParser::isLetter(char c){ return std::isalpha(c); }
 bool MathParser::isDigit(char c){ return std::isdigit(c) || c == '.'; }
 
-std::vector<MathParser::Token> MathParser::tokenize(const std::string& expr) {
-    std::vector<Token> tokens;
+bool MathParser::functionCode(std::string_view name, CompiledExpression::OpCode& op) {
+    typedef CompiledExpression CE;
+
+    if (name == "sin") op = CE::OP_SIN;
+    else if (name == "cos") op = CE::OP_COS;
+    else if (name == "tan") op = CE::OP_TAN;
+    else if (name == "exp") op = CE::OP_EXP;
+    else if (name == "log") op = CE::OP_LOG;
+    else return false;
+    return true;
+}
+
+const std::vector<MathParser::Token>& MathParser::tokenize(std::string_view expr,
+                                                          const std::vector<std::string>* parameters) {
+    typedef CompiledExpression CE;
+    std::vector<Token>& tokens = tokenBuf;
+    tokens.clear();
 
     // Helper to push a token with implicit multiplication insertion when needed
     auto pushToken = [&](const Token& t){
@@ -22,16 +99,11 @@ std::vector<MathParser::Token> MathParser::tokenize(const std::string& expr) {
             const Token& prev = tokens.back();
             bool prevCanMultiply = (prev.type == NUMBER || prev.type == VARIABLE || prev.type == RPAREN);
             bool currCanMultiply = (t.type == NUMBER || t.type == VARIABLE || t.type == FUNCTION || t.type == LPAREN);
-            bool isFunctionCall = (prev.type == FUNCTION && t.type == LPAREN); // sin( ... )
 
             // Insert implicit multiplication for patterns like: 2x, x2, 2(x+1), x(x+1), (x+1)2, (x+1)x, 2sin(x), xsin(x)
+            // (FUNCTION followed by LPAREN is a call and never gets one)
             if (prevCanMultiply && currCanMultiply) {
-                tokens.push_back({OPERATOR, "*"});
-            }
-
-            // Do NOT insert between FUNCTION and LPAREN (that is a function call)
-            if (isFunctionCall) {
-                // No op; the function token followed by '(' is handled naturally
+                tokens.push_back({OPERATOR, CE::OP_MUL, "*"});
             }
         }
         tokens.push_back(t);
@@ -43,54 +115,86 @@ std::vector<MathParser::Token> MathParser::tokenize(const std::string& expr) {
         if (c == ' ') { i++; continue; }
 
         if (isDigit(c)) {
-            std::string num;
-            while (i < expr.size() && isDigit(expr[i]))
-                num += expr[i++];
-            pushToken({NUMBER, num});
+            size_t start = i;
+            while (i < expr.size() && isDigit(expr[i])) i++;
+            std::string_view num = expr.substr(start, i - start);
+
+            // Like std::stod, reads the longest valid prefix ("1.2.3" is 1.2)
+            double value;
+            if (std::from_chars(num.data(), num.data() + num.size(), value).ec != std::errc())
+                throw std::runtime_error("Invalid number '" + std::string(num) + "'");
+            pushToken({NUMBER, CE::OP_CONST, num, value});
             continue;
         }
 
         if (isLetter(c)) {
-            std::string name;
-            while (i < expr.size() && isLetter(expr[i]))
-                name += expr[i++];
-
-            if (name == "sin" || name == "cos")
-                pushToken({FUNCTION, name});
-            else
-                pushToken({VARIABLE, name});
-            continue;
-        }
+            size_t start = i;
+            while (i < expr.size() && isLetter(expr[i])) i++;
+            std::string_view name = expr.substr(start, i - start);
 
-        if (c == '(') { pushToken({LPAREN, "("}); i++; continue; }
-        if (c == ')') { pushToken({RPAREN, ")"}); i++; continue; }
+            CE::OpCode op;
+            if (functionCode(name, op)) {
+                pushToken({FUNCTION, op, name});
+                continue;
+            }
+            if (name == "x") {
+                pushToken({VARIABLE, CE::OP_VAR, name});
+                continue;
+            }
 
-        if (std::string("+-*/^").find(c) != std::string::npos) {
-            pushToken({OPERATOR, std::string(1, c)});
-            i++;
+            // Parameters are bound to their index here, once
+            Token param{VARIABLE, CE::OP_PARAM, name};
+            param.param = -1;
+            if (parameters) {
+                for (size_t k = 0; k < parameters->size(); ++k)
+                    if ((*parameters)[k] == name) param.param = int(k);
+            }
+            if (param.param < 0)
+                throw std::runtime_error("Unknown name '" + std::string(name) + "'");
+            pushToken(param);
             continue;
         }
 
-        throw std::runtime_error("Invalid character in expression");
+        std::string_view text = expr.substr(i, 1);
+        switch (c) {
+            case '(': pushToken({LPAREN, CE::OP_CONST, text}); break;
+            case ')': pushToken({RPAREN, CE::OP_CONST, text}); break;
+            case '+': pushToken({OPERATOR, CE::OP_ADD, text}); break;
+            case '-': pushToken({OPERATOR, CE::OP_SUB, text}); break;
+            case '*': pushToken({OPERATOR, CE::OP_MUL, text}); break;
+            case '/': pushToken({OPERATOR, CE::OP_DIV, text}); break;
+            case '^': pushToken({OPERATOR, CE::OP_POW, text}); break;
+            default:
+                throw std::runtime_error("Invalid character in expression");
+        }
+        i++;
     }
 
     return tokens;
 }
 
-int MathParser::precedence(const std::string& op) {
-    if (op == "^") return 3;
-    if (op == "*" || op == "/") return 2;
-    if (op == "+" || op == "-") return 1;
-    return 0;
+int MathParser::precedence(CompiledExpression::OpCode op) {
+    typedef CompiledExpression CE;
+
+    switch (op) {
+        case CE::OP_POW: return 3;
+        case CE::OP_MUL:
+        case CE::OP_DIV: return 2;
+        case CE::OP_ADD:
+        case CE::OP_SUB: return 1;
+        default:         return 0;
+    }
 }
 
-bool MathParser::isRightAssociative(const std::string& op) {
-    return op == "^";
+bool MathParser::isRightAssociative(CompiledExpression::OpCode op) {
+    return op == CompiledExpression::OP_POW;
 }
 
-std::vector<MathParser::Token> MathParser::toRPN(const std::vector<Token>& tokens) {
-    std::vector<Token> output;
-    std::stack<Token> ops;
+const std::vector<MathParser::Token>& MathParser::toRPN(const std::vector<Token>& tokens) {
+    std::vector<Token>& output = rpnBuf;
+    std::vector<Token>& ops = opStack;
+    output.clear();
+    ops.clear();
 
     for (const Token& t : tokens) {
         switch (t.type) {
@@ -100,82 +204,80 @@ std::vector<MathParser::Token> MathParser::toRPN(const std::vector<Token>& token
                 break;
 
             case FUNCTION:
-                ops.push(t);
+                ops.push_back(t);
                 break;
 
             case OPERATOR:
                 while (!ops.empty() &&
-                       (ops.top().type == OPERATOR || ops.top().type == FUNCTION) &&
-                       (precedence(ops.top().value) > precedence(t.value) ||
-                       (precedence(ops.top().value) == precedence(t.value) &&
-                        !isRightAssociative(t.value)))) 
+                       (ops.back().type == OPERATOR || ops.back().type == FUNCTION) &&
+                       (precedence(ops.back().op) > precedence(t.op) ||
+                       (precedence(ops.back().op) == precedence(t.op) &&
+                        !isRightAssociative(t.op))))
                 {
-                    output.push_back(ops.top());
-                    ops.pop();
+                    output.push_back(ops.back());
+                    ops.pop_back();
                 }
-                ops.push(t);
+                ops.push_back(t);
                 break;
 
             case LPAREN:
-                ops.push(t);
+                ops.push_back(t);
                 break;
 
             case RPAREN:
-                while (!ops.empty() && ops.top().type != LPAREN) {
-                    output.push_back(ops.top());
-                    ops.pop();
+                while (!ops.empty() && ops.back().type != LPAREN) {
+                    output.push_back(ops.back());
+                    ops.pop_back();
                 }
-                if (!ops.empty()) ops.pop();
+                if (!ops.empty()) ops.pop_back();
 
-                if (!ops.empty() && ops.top().type == FUNCTION) {
-                    output.push_back(ops.top());
-                    ops.pop();
+                if (!ops.empty() && ops.back().type == FUNCTION) {
+                    output.push_back(ops.back());
+                    ops.pop_back();
                 }
                 break;
         }
     }
 
     while (!ops.empty()) {
-        output.push_back(ops.top());
-        ops.pop();
+        output.push_back(ops.back());
+        ops.pop_back();
     }
 
     return output;
 }
 
-double MathParser::evalRPN(const std::vector<Token>& rpn, double xValue) {
-    std::stack<double> st;
+// Turns RPN tokens into opcodes, tracking the stack depth so that malformed
+// input is rejected here instead of underflowing the evaluator. The depth is
+// not limited here: nothing runs this program as it is, and the reordered
+// one ExprGraph emits is checked against kMaxStack there.
+const CompiledExpression& MathParser::lower(const std::vector<Token>& rpn) {
+    CompiledExpression& compiled = lowered;
+    compiled.code.clear();
+    compiled.maxDepth = 0;
+    compiled.numSlots = 0;
 
+    int depth = 0;
     for (const Token& t : rpn) {
-        if (t.type == NUMBER) {
-            st.push(std::stod(t.value));
-        }
-        else if (t.type == VARIABLE) {
-            st.push(xValue);
-        }
-        else if (t.type == OPERATOR) {
-            double b = st.top(); st.pop();
-            double a = st.top(); st.pop();
-
-            if (t.value == "+") st.push(a + b);
-            else if (t.value == "-") st.push(a - b);
-            else if (t.value == "*") st.push(a * b);
-            else if (t.value == "/") st.push(a / b);
-            else if (t.value == "^") st.push(std::pow(a, b));
-        }
-        else if (t.type == FUNCTION) {
-            double a = st.top(); st.pop();
-
-            if (t.value == "sin") st.push(std::sin(a));
-            else if (t.value == "cos") st.push(std::cos(a));
-            else if(t.value == "tan") st.push(std::tan(a));
-            else if(t.value == "exp") st.push(std::exp(a));
-            else if(t.value == "log") st.push(std::log(a));
-            else {
-                throw std::runtime_error("Unknown function: " + t.value);
-            }
+        if (t.type == LPAREN || t.type == RPAREN)
+            throw std::runtime_error("Mismatched parentheses");
+
+        if (t.type == NUMBER || t.type == VARIABLE) {
+            depth++;
+        } else {
+            int arity = (t.type == OPERATOR) ? 2 : 1;
+            if (depth < arity)
+                throw std::runtime_error("Malformed expression near '" + std::string(t.text) + "'");
+            depth -= arity - 1;
         }
+
+        if (depth > compiled.maxDepth) compiled.maxDepth = depth;
+
+        compiled.code.push_back({t.op, t.param, t.number});
     }
 
-    return st.top();
-}
\ No newline at end of file
+    if (depth != 1)
+        throw std::runtime_error(rpn.empty() ? "Empty expression" : "Malformed expression");
+
+    return compiled;
+}
@@ -1,7 +1,10 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include "CompiledExpression.hpp"
+#include "ExprGraph.hpp"
 
 class MathParser {
 public:
@@ -15,20 +18,72 @@ public:
         RPAREN
     };
 
+    // Tokens point into the source string and carry their operator or
+    // function as an opcode, so tokenizing copies no text.
     struct Token {
         TokenType type;
-        std::string value;
+        CompiledExpression::OpCode op; // OPERATOR / FUNCTION: what it computes
+        std::string_view text;         // the characters this token came from
+        double number = 0.0;           // parsed value of a NUMBER token
+        int param = 0;                 // OP_PARAM: index of the parameter
     };
 
+    MathParser();
+
+    // Parses expr once; the result can be evaluated at any number of points.
+    // The parser keeps its token buffers between calls, so compiling with a
+    // reused MathParser does not allocate beyond the result itself and its
+    // native code. One parser must not be used from several threads at once.
+    // The only variable is x. Other names are an error unless they are in
+    // parameters, where each becomes the parameter of the same index in the
+    // result (see CompiledExpression::setParameter): no name is looked up
+    // when evaluating.
+    CompiledExpression compile(const std::string& expr);
+    CompiledExpression compile(const std::string& expr, const std::vector<std::string>& parameters);
+
+    // Names in expr other than x and the functions, once each, in order of
+    // first appearance: what compile() needs as parameters for expr.
+    static std::vector<std::string> names(const std::string& expr);
+
     double evaluate(const std::string& expr, double xValue);
 
+    // Whether compile() also translates programs to native code (Jit.hpp).
+    // On by default where the JIT is available; it cannot be turned on
+    // elsewhere.
+    void setJit(bool enabled);
+    bool jitEnabled() const { return jit; }
+
+    // Whether compile() hands polynomials to Horner's rule (see
+    // CompiledExpression::coefficients) rather than running their program.
+    // On by default.
+    void setPolynomials(bool enabled) { polynomials = enabled; }
+    bool polynomialsEnabled() const { return polynomials; }
+
 private:
-    bool isLetter(char c);
-    bool isDigit(char c);
-
-    std::vector<Token> tokenize(const std::string& expr);
-    int precedence(const std::string& op);
-    bool isRightAssociative(const std::string& op);
-    std::vector<Token> toRPN(const std::vector<Token>& tokens);
-    double evalRPN(const std::vector<Token>& rpn, double xValue);
+    // benchmark.cpp times tokenize, toRPN and lower separately
+    friend struct ParserStages;
+
+    static bool isLetter(char c);
+    static bool isDigit(char c);
+    static bool functionCode(std::string_view name, CompiledExpression::OpCode& op);
+
+    // compile() without the native code
+    CompiledExpression compileProgram(const std::string& expr, const std::vector<std::string>& parameters);
+
+    // These return one of the buffers below, valid until the next call.
+    const std::vector<Token>& tokenize(std::string_view expr,
+                                       const std::vector<std::string>* parameters = nullptr);
+    static int precedence(CompiledExpression::OpCode op);
+    static bool isRightAssociative(CompiledExpression::OpCode op);
+    const std::vector<Token>& toRPN(const std::vector<Token>& tokens);
+    const CompiledExpression& lower(const std::vector<Token>& rpn);
+
+    // Scratch storage reused by every parse
+    std::vector<Token> tokenBuf;
+    std::vector<Token> rpnBuf;
+    std::vector<Token> opStack;
+    CompiledExpression lowered;
+    ExprGraph graph;
+    bool jit;
+    bool polynomials = true;
 };
@@ -0,0 +1,193 @@
+#include "TraceFile.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char kMagic[8] = {'S', 'E', 'C', 'T', 'R', 'A', 'C', 'E'};
+const uint32_t kVersion = 1;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t blockRows;
+    uint32_t columns;
+    uint32_t reserved;
+    int64_t rows;    // rows stored
+    int64_t steps;   // steps appended, stored or not
+    int64_t keepAll; // TraceOptions::keepAll when written
+    char pad[16];
+};
+static_assert(sizeof(Header) == 64, "the header is 64 bytes");
+
+std::runtime_error systemError(const std::string& what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+void writeAll(int fd, const void* data, size_t size, off_t offset) {
+    const char* p = (const char*)data;
+    while (size > 0) {
+        ssize_t n = ::pwrite(fd, p, size, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) throw systemError("trace write");
+        p += n;
+        size -= size_t(n);
+        offset += n;
+    }
+}
+
+} // namespace
+
+TraceWriter::TraceWriter(const std::string& path, const TraceOptions& opts)
+    : opts(opts), block(size_t(Trace::kColumns) * Trace::kBlockRows) {
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) throw systemError("Cannot create " + path);
+    flush();
+}
+
+TraceWriter::~TraceWriter() {
+    try {
+        close();
+    } catch (const std::exception&) {
+        // Nothing to report to from here; the rows already written stay valid
+    }
+}
+
+void TraceWriter::append(const RootSolver::Step& step) {
+    offered++;
+    last = step;
+
+    // Every stored keepAll rows, the stride between stored steps doubles
+    long stride = 1;
+    if (opts.keepAll > 0) stride = 1L << std::min(stored / opts.keepAll, 62L);
+    if (skipped + 1 < stride) {
+        skipped++;
+        return;
+    }
+    skipped = 0;
+    store(step);
+}
+
+void TraceWriter::store(const RootSolver::Step& s) {
+    const double values[Trace::kColumns] = {double(s.n), s.a, s.fa, s.b, s.fb, s.x, s.fx, s.dx};
+    for (int c = 0; c < Trace::kColumns; ++c)
+        block[size_t(c) * Trace::kBlockRows + fill] = values[c];
+    fill++;
+    stored++;
+
+    if (fill == Trace::kBlockRows) {
+        writeBlock();
+        blocks++;
+        fill = 0;
+        flush();
+    }
+}
+
+void TraceWriter::writeBlock() {
+    size_t bytes = block.size() * sizeof(double);
+    writeAll(fd, block.data(), bytes, off_t(sizeof(Header) + size_t(blocks) * bytes));
+}
+
+void TraceWriter::flush() {
+    if (fd < 0) return;
+    if (fill > 0) writeBlock(); // rewritten in place until it is full
+
+    // The header goes last, so a reader never counts rows not yet written
+    Header h;
+    std::memset(&h, 0, sizeof h);
+    std::memcpy(h.magic, kMagic, sizeof kMagic);
+    h.version = kVersion;
+    h.blockRows = Trace::kBlockRows;
+    h.columns = Trace::kColumns;
+    h.rows = stored;
+    h.steps = offered;
+    h.keepAll = opts.keepAll;
+    writeAll(fd, &h, sizeof h, 0);
+}
+
+void TraceWriter::close() {
+    if (fd < 0) return;
+    if (skipped > 0) {
+        skipped = 0;
+        store(last);
+    }
+    flush();
+    ::close(fd);
+    fd = -1;
+}
+
+TraceReader::TraceReader(const std::string& path) {
+    open(path);
+}
+
+TraceReader::~TraceReader() {
+    close();
+}
+
+void TraceReader::open(const std::string& path) {
+    close();
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw systemError("Cannot open " + path);
+
+    Header h;
+    if (::pread(fd, &h, sizeof h, 0) != ssize_t(sizeof h) || std::memcmp(h.magic, kMagic, sizeof kMagic) != 0 ||
+        h.version != kVersion || h.columns != uint32_t(Trace::kColumns) || h.blockRows == 0) {
+        close();
+        throw std::runtime_error(path + " is not a trace file");
+    }
+    blockRows = h.blockRows;
+    refresh();
+}
+
+void TraceReader::close() {
+    if (base) ::munmap((void*)base, mapped);
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+    base = nullptr;
+    mapped = 0;
+    count = stepCount = 0;
+}
+
+long TraceReader::refresh() {
+    if (fd < 0) return 0;
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) return count;
+    size_t size = size_t(st.st_size);
+    if (size > mapped) {
+        void* p = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) return count; // keep the old mapping
+        if (base) ::munmap((void*)base, mapped);
+        base = (const char*)p;
+        mapped = size;
+    }
+    if (mapped < kHeaderBytes) return count;
+
+    Header h;
+    std::memcpy(&h, base, sizeof h);
+    // Only whole blocks are ever in the file, but it may have grown since
+    // it was mapped
+    long available = long((mapped - kHeaderBytes) / blockBytes()) * long(blockRows);
+    count = std::min(long(h.rows), available);
+    stepCount = long(h.steps);
+    return count;
+}
+
+RootSolver::Step TraceReader::row(long i) const {
+    RootSolver::Step s{};
+    s.n = int(value(i, Trace::N));
+    s.a = value(i, Trace::A);
+    s.fa = value(i, Trace::FA);
+    s.b = value(i, Trace::B);
+    s.fb = value(i, Trace::FB);
+    s.x = value(i, Trace::X);
+    s.fx = value(i, Trace::FX);
+    s.dx = value(i, Trace::DX);
+    return s;
+}
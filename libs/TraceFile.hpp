@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Solvers.hpp"
+
+struct TraceOptions {
+    // 0 keeps every step. Otherwise the first keepAll rows are every step,
+    // the next keepAll every second step, then every fourth and so on, so a
+    // run of n steps stores about keepAll * log2(n / keepAll) rows. The last
+    // step is always kept.
+    long keepAll = 0;
+};
+
+// Iteration traces of RootSolver as a binary file of fixed-size column
+// blocks: a 64-byte header, then blocks of kBlockRows rows holding each of
+// the kColumns columns contiguously (all doubles, native byte order). Rows
+// are only ever appended, so a reader can map the file while it is being
+// written and find any row without scanning: row i is in block
+// i / kBlockRows, at a fixed offset in each column. Nothing is formatted as
+// text on the way in; that is left to whoever displays the rows.
+namespace Trace {
+
+enum Column { N, A, FA, B, FB, X, FX, DX, kColumns };
+
+const uint32_t kBlockRows = 1024;
+
+} // namespace Trace
+
+class TraceWriter {
+public:
+    // Creates (or truncates) path. Throws std::runtime_error if it cannot.
+    explicit TraceWriter(const std::string& path, const TraceOptions& opts = TraceOptions());
+    ~TraceWriter(); // close()
+
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    // Stores the step unless decimation skips it.
+    void append(const RootSolver::Step& step);
+
+    // Writes the rows so far, then the header that makes them visible to
+    // readers. Full blocks are written as they fill; this adds the last one.
+    void flush();
+
+    // Adds the last step if it was skipped, flushes and closes the file.
+    void close();
+
+    long rows() const { return stored; }
+    long steps() const { return offered; }
+
+private:
+    void store(const RootSolver::Step& step);
+    void writeBlock();
+
+    int fd = -1;
+    TraceOptions opts;
+    std::vector<double> block; // the block being filled, column by column
+    uint32_t fill = 0;         // rows in it
+    long blocks = 0;           // blocks before it in the file
+    long stored = 0;
+    long offered = 0;
+    long skipped = 0;          // steps since the last one stored
+    RootSolver::Step last{};
+};
+
+class TraceReader {
+public:
+    TraceReader() {}
+    // Maps path. Throws std::runtime_error if it is not a trace file.
+    explicit TraceReader(const std::string& path);
+    ~TraceReader(); // close()
+
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+
+    void open(const std::string& path);
+    void close();
+    bool isOpen() const { return fd >= 0; }
+
+    // Picks up rows appended since the last call, remapping the file if it
+    // has grown. Returns rows().
+    long refresh();
+
+    long rows() const { return count; }
+    long steps() const { return stepCount; } // including the decimated ones
+
+    double value(long row, Trace::Column column) const {
+        const double* b = (const double*)(base + kHeaderBytes + size_t(row / blockRows) * blockBytes());
+        return b[size_t(column) * blockRows + size_t(row % blockRows)];
+    }
+
+    // Row 0 <= i < rows(). The bracketed flag is not stored.
+    RootSolver::Step row(long i) const;
+
+private:
+    static const size_t kHeaderBytes = 64;
+    size_t blockBytes() const { return size_t(Trace::kColumns) * blockRows * sizeof(double); }
+
+    int fd = -1;
+    const char* base = nullptr;
+    size_t mapped = 0;
+    uint32_t blockRows = Trace::kBlockRows;
+    long count = 0;
+    long stepCount = 0;
+};
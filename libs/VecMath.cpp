@@ -0,0 +1,258 @@
+#include "VecMath.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// Kernels work on chunks of this many lanes so they can keep scratch arrays
+// on the stack while still letting the caller pass aliasing in/out pointers.
+const size_t kChunk = 64;
+
+inline uint64_t bits_of(double d)  { uint64_t u; std::memcpy(&u, &d, sizeof u); return u; }
+inline double   from_bits(uint64_t u) { double d; std::memcpy(&d, &u, sizeof d); return d; }
+
+// Adding this to a double with |v| < 2^51 rounds it to an integer held in the
+// low mantissa bits, which avoids a (non-vectorizable) call to nearbyint.
+const double   kRoundMagic     = 6755399441055744.0; // 1.5 * 2^52
+const uint64_t kRoundMagicBits = 0x4338000000000000ULL;
+
+// floor() for 0 <= v < 2^51. std::floor only vectorizes under
+// -fno-trapping-math, so round with the magic constant and correct downwards.
+inline double floor_nonneg(double v) {
+    double t = (v + kRoundMagic) - kRoundMagic;
+    return t > v ? t - 1.0 : t;
+}
+
+// 2^n for integer-valued n in [-1022, 1023].
+inline double pow2i(int64_t n) { return from_bits(uint64_t(n + 1023) << 52); }
+
+// The largest double whose exp is finite, log(DBL_MAX) rounded down.
+const double kExpMax = 709.782712893384;
+
+inline double exp_kernel(double x) {
+    const double LOG2E = 1.4426950408889634073599;
+    const double C1 = 6.93145751953125E-1;
+    const double C2 = 1.42860682030941723212E-6;
+
+    double xc = x > kExpMax ? kExpMax : (x < -745.2 ? -745.2 : x);
+    double t  = xc * LOG2E + kRoundMagic;
+    int64_t n = int64_t(bits_of(t) - kRoundMagicBits);
+    double fn = t - kRoundMagic;
+
+    double r  = (xc - fn * C1) - fn * C2;
+    double rr = r * r;
+    double px = r * ((1.26177193074810590878E-4 * rr + 3.02994407707441961300E-2) * rr
+                     + 9.99999999999999999910E-1);
+    double qx = ((3.00198505138664455042E-6 * rr + 2.52448340349684104192E-3) * rr
+                 + 2.27265548208155028766E-1) * rr + 2.00000000000000000009E0;
+    double e  = 1.0 + 2.0 * px / (qx - px);
+
+    // Split the scale in two so results near overflow/underflow stay exact.
+    int64_t n1 = n >> 1;
+    double y = e * pow2i(n1) * pow2i(n - n1);
+
+    y = x > kExpMax ? std::numeric_limits<double>::infinity() : y;
+    y = x < -745.2 ? 0.0 : y;
+    return x != x ? x : y;
+}
+
+// Error-free transformations used to carry extra bits through pow.
+inline double two_sum(double a, double b, double& err) {
+    double s  = a + b;
+    double bb = s - a;
+    err = (a - (s - bb)) + (b - bb);
+    return s;
+}
+
+inline double two_prod(double a, double b, double& err) {
+    double p = a * b;
+#ifdef __FMA__
+    err = std::fma(a, b, -p);
+#else
+    const double split = 134217729.0; // 2^27 + 1
+    double ca = split * a, ah = ca - (ca - a), al = a - ah;
+    double cb = split * b, bh = cb - (cb - b), bl = b - bh;
+    err = ((ah * bh - p) + ah * bl + al * bh) + al * bl;
+#endif
+    return p;
+}
+
+// log(x) as an unevaluated sum hi + lo. Only positive finite x is meaningful;
+// log_kernel patches the special cases.
+inline double log_kernel_dd(double x, double& lo) {
+    const double SQRTH = 0.70710678118654752440;
+
+    // Scale subnormals into the normal range first.
+    bool sub = x < 2.2250738585072014e-308;
+    double xs = sub ? x * 4503599627370496.0 : x; // 2^52
+    uint64_t u = bits_of(xs);
+    // Biased exponent k as a double: bits(2^52 + k) - 2^52, which needs no
+    // int64 -> double conversion (not vectorizable without AVX-512DQ).
+    double k = from_bits(((u >> 52) & 0x7ff) | 0x4330000000000000ULL) - 4503599627370496.0;
+    double e = k - 1022.0 - (sub ? 52.0 : 0.0);
+    double m = from_bits((u & 0x000fffffffffffffULL) | 0x3fe0000000000000ULL); // [0.5, 1)
+
+    bool low = m < SQRTH;
+    e = low ? e - 1.0 : e;
+    m = low ? (m + m) - 1.0 : m - 1.0;
+
+    double z = m * m;
+    double p = ((((1.01875663804580931796E-4 * m + 4.97494994976747001425E-1) * m
+                 + 4.70579119878881725854E0) * m + 1.44989225341610930846E1) * m
+                 + 1.79368678507819816313E1) * m + 7.70838733755885391666E0;
+    double q = ((((m + 1.12873587189167450590E1) * m + 4.52279145837532221105E1) * m
+                 + 8.29875266912776603211E1) * m + 7.11544750618563894466E1) * m
+                 + 2.31251620126765340583E1;
+    double y = m * (z * p / q);
+    y = y - e * 2.121944400546905827679e-4;
+    y = y - 0.5 * z;
+
+    // e * 0.693359375 is exact, so only the two additions need compensating.
+    double e1, e2;
+    double s = two_sum(e * 0.693359375, m, e1);
+    double h = two_sum(s, y, e2);
+    double l = e1 + e2;
+    double hi = h + l;
+    lo = l - (hi - h);
+    return hi;
+}
+
+inline double log_kernel(double x) {
+    double lo;
+    double r = log_kernel_dd(x, lo) + lo;
+
+    r = x == 0.0 ? -std::numeric_limits<double>::infinity() : r;
+    r = x < 0.0 ? std::numeric_limits<double>::quiet_NaN() : r;
+    r = x == std::numeric_limits<double>::infinity() ? x : r;
+    return x != x ? x : r;
+}
+
+// a^b for positive finite a: exp of a double-double b*log(a), so the error
+// does not grow with the magnitude of the exponent.
+inline double pow_kernel(double a, double b) {
+    double llo;
+    double lhi = log_kernel_dd(a, llo);
+    double perr;
+    double p = two_prod(b, lhi, perr);
+    perr += b * llo;
+    double y = exp_kernel(p);
+    return y + y * perr;
+}
+
+// Arguments beyond this lose accuracy in the three-part reduction below.
+const double kTrigLimit = 1.0e8;
+
+// Shared by sin and cos: reduces |x| by multiples of pi/4 and evaluates the
+// matching polynomial. 'quadrantShift' is 0 for sin and 2 for cos.
+inline double trig_kernel(double x, double quadrantShift, bool useSign) {
+    const double FOPI = 1.27323954473516268615; // 4/pi
+    const double DP1 = 7.85398125648498535156E-1;
+    const double DP2 = 3.77489470793079817668E-8;
+    const double DP3 = 2.69515142907905952645E-15;
+
+    double ax = std::fabs(x);
+    ax = ax <= kTrigLimit ? ax : 0.0; // out-of-range lanes are patched by the caller
+
+    // Octant bookkeeping is done in doubles: mixing int and double lanes in
+    // one loop stops GCC from vectorizing it. After rounding up to an even
+    // octant, j is 0 (sin polynomial) or 2 (cos polynomial) modulo 4.
+    double y = floor_nonneg(ax * FOPI);
+    y += y - 2.0 * floor_nonneg(0.5 * y);
+    double j = y + quadrantShift;
+    j -= 8.0 * floor_nonneg(0.125 * j);
+
+    double sign = useSign ? std::copysign(1.0, x) : 1.0;
+    sign = (j > 3.0) ? -sign : sign;
+    j = (j > 3.0) ? j - 4.0 : j;
+
+    double z  = ((ax - y * DP1) - y * DP2) - y * DP3;
+    double zz = z * z;
+
+    double s = z + z * zz * (((((1.58962301576546568060E-10 * zz - 2.50507477628578072866E-8) * zz
+                 + 2.75573136213857245213E-6) * zz - 1.98412698295895385996E-4) * zz
+                 + 8.33333333332211858878E-3) * zz - 1.66666666666666307295E-1);
+    double c = 1.0 - 0.5 * zz + zz * zz * (((((-1.13585365213876817300E-11 * zz
+                 + 2.08757008419747316778E-9) * zz - 2.75573141792967388112E-7) * zz
+                 + 2.48015872888517045348E-5) * zz - 1.38888888888730564116E-3) * zz
+                 + 4.16666666666665929218E-2);
+
+    double r = (j == 2.0) ? c : s;
+    return sign * r;
+}
+
+template <typename Kernel, typename Fallback>
+void apply_chunked(const double* in, double* out, size_t n,
+                   Kernel kernel, Fallback fallback, double limit) {
+    double tmp[kChunk];
+    for (size_t base = 0; base < n; base += kChunk) {
+        size_t m = (n - base < kChunk) ? n - base : kChunk;
+        const double* src = in + base;
+
+        for (size_t i = 0; i < m; ++i)
+            tmp[i] = kernel(src[i]);
+
+        bool needFix = false;
+        for (size_t i = 0; i < m; ++i)
+            needFix |= !(std::fabs(src[i]) <= limit);
+
+        if (needFix) {
+            for (size_t i = 0; i < m; ++i)
+                if (!(std::fabs(src[i]) <= limit)) tmp[i] = fallback(src[i]);
+        }
+
+        std::memcpy(out + base, tmp, m * sizeof(double));
+    }
+}
+
+} // namespace
+
+void vec_sin(const double* in, double* out, size_t n) {
+    apply_chunked(in, out, n,
+                  [](double x) { return trig_kernel(x, 0, true); },
+                  [](double x) { return std::sin(x); }, kTrigLimit);
+}
+
+void vec_cos(const double* in, double* out, size_t n) {
+    apply_chunked(in, out, n,
+                  [](double x) { return trig_kernel(x, 2, false); },
+                  [](double x) { return std::cos(x); }, kTrigLimit);
+}
+
+void vec_exp(const double* in, double* out, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        out[i] = exp_kernel(in[i]);
+}
+
+void vec_log(const double* in, double* out, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        out[i] = log_kernel(in[i]);
+}
+
+void vec_pow(const double* base, const double* expo, double* out, size_t n) {
+    const double inf = std::numeric_limits<double>::infinity();
+    double tmp[kChunk];
+
+    for (size_t start = 0; start < n; start += kChunk) {
+        size_t m = (n - start < kChunk) ? n - start : kChunk;
+        const double* a = base + start;
+        const double* b = expo + start;
+
+        for (size_t i = 0; i < m; ++i)
+            tmp[i] = pow_kernel(a[i], b[i]);
+
+        // Only positive finite bases with finite exponents take the fast path.
+        bool needFix = false;
+        for (size_t i = 0; i < m; ++i)
+            needFix |= !((a[i] > 0.0) & (a[i] < inf) & (std::fabs(b[i]) < inf));
+
+        if (needFix) {
+            for (size_t i = 0; i < m; ++i)
+                if (!((a[i] > 0.0) & (a[i] < inf) & (std::fabs(b[i]) < inf)))
+                    tmp[i] = std::pow(a[i], b[i]);
+        }
+
+        std::memcpy(out + start, tmp, m * sizeof(double));
+    }
+}
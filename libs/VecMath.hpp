@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+
+// Array versions of the libm functions used by the expression evaluator.
+// The kernels are branch-free polynomial approximations (after Cephes) so the
+// compiler can vectorize them; lanes they cannot handle accurately (huge
+// arguments for sin/cos, non-positive bases for pow) fall back to <cmath>.
+// Accuracy is within a few ulp of <cmath>. in and out may alias.
+
+void vec_sin(const double* in, double* out, size_t n);
+void vec_cos(const double* in, double* out, size_t n);
+void vec_exp(const double* in, double* out, size_t n);
+void vec_log(const double* in, double* out, size_t n);
+
+// out[i] = base[i] ^ expo[i]; out may alias either input.
+void vec_pow(const double* base, const double* expo, double* out, size_t n);
@@ -1,7 +1,11 @@
 // horner_subscript.cpp
+// g++ -std=c++17 -O2 polynomial-horner.cpp libs/AberthSolver.cpp libs/Horner.cpp libs/ThreadPool.cpp -pthread -o polynomial_horner
 #include <iostream>
 #include <string>
+#include <vector>
 #include <clocale>   // for setlocale
+#include "libs/AberthSolver.hpp"
+#include "libs/Horner.hpp"
 
 #ifdef _WIN32
 #include <windows.h> // for SetConsoleOutputCP
@@ -35,26 +39,16 @@ string toSub(int num)
     return out;
 }
 
-double horner(double a[], int n, double x, bool useUnicode)
+// Prints the partial results of Horner's rule (see libs/Horner.hpp).
+void printSteps(const vector<HornerStep>& steps, bool useUnicode)
 {
-    double result = a[0];
-
-    if (useUnicode)
-        cout << "p" << toSub(n) << ": " << result << '\n';
-    else
-        cout << "p" << n << "_: " << result << '\n';
-
-    int currentPower = n - 1;
-    for (int i = 1; i <= n; ++i)
+    for (const HornerStep& step : steps)
     {
-        result = result * x + a[i];
         if (useUnicode)
-            cout << "p" << toSub(currentPower) << ": " << result << '\n';
+            cout << "p" << toSub(step.power) << ": " << step.value << '\n';
         else
-            cout << "p" << currentPower << "_: " << result << '\n';
-        --currentPower;
+            cout << "p" << step.power << "_: " << step.value << '\n';
     }
-    return result;
 }
 
 int main()
@@ -71,8 +65,13 @@ int main()
     int n;
     cout << "Please Enter polynomial degree: ";
     if (!(cin >> n)) return 0;
+    if (n < 0)
+    {
+        cerr << "The degree must not be negative." << endl;
+        return 1;
+    }
 
-    double a[200];
+    vector<double> a(n + 1);
 
     cout << "\nEnter coefficients (highest degree first):\n\n";
     for (int i = n; i >= 0; i--)
@@ -89,8 +88,44 @@ int main()
     cin >> x;
 
     cout << "\n--- Horner's Method Steps ---\n";
-    double result = horner(a, n, x, useUnicode);
+    vector<HornerStep> steps;
+    double result = horner_trace(a.data(), n, x, steps);
+    printSteps(steps, useUnicode);
 
     cout << "\nFinal Result = " << result << endl;
+
+    // Same evaluation with the rounding errors of every step added back in;
+    // near a root of an ill-conditioned polynomial the two can differ a lot
+    CompensatedResult<double> accurate = horner_compensated(a.data(), n, x);
+    cout.precision(17);
+    cout << "Compensated Result = " << accurate.value
+         << " (error at most " << accurate.errorBound << ")" << endl;
+
+    if (n == 0) return 0;
+
+    cout << "\n--- All Roots (Aberth-Ehrlich) ---\n";
+    ThreadPool pool;
+    AberthSolver::Result roots;
+    try
+    {
+        roots = AberthSolver(&pool).solve(a.data(), n);
+    }
+    catch (const exception& e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    cout.precision(15);
+    for (const AberthSolver::Root& r : roots.roots)
+    {
+        cout << "x = " << r.z.real();
+        if (r.z.imag() != 0.0)
+            cout << (r.z.imag() < 0 ? " - " : " + ") << abs(r.z.imag()) << "i";
+        cout.precision(3);
+        cout << "   (within " << r.radius << (r.converged ? ")" : ", not converged)") << '\n';
+        cout.precision(15);
+    }
+    cout << roots.iterations << " iterations" << endl;
     return 0;
 }
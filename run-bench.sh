@@ -0,0 +1,5 @@
+# Builds the headless benchmark and writes its JSON report to bench.json.
+# Run it before and after a change and compare the ns_per_op figures.
+
+g++ -std=c++17 -O3 -march=native benchmark.cpp libs/AberthSolver.cpp libs/Tokenizer.cpp libs/CompiledExpression.cpp libs/EvalMemo.cpp libs/ExprGraph.cpp libs/Horner.cpp libs/Instrument.cpp libs/Interval.cpp libs/Jit.cpp libs/Solvers.cpp libs/ThreadPool.cpp libs/TraceFile.cpp libs/VecMath.cpp -pthread -o secant_bench
+./secant_bench "$@" > bench.json
@@ -0,0 +1,4 @@
+# Builds the client for ./secant_method --serve (see run.sh).
+# ./secant_client jobs.csv, ./secant_client -e "x^2-2,1,2,1e-12", or stdin.
+
+g++ -std=c++17 -O2 secant-client.cpp -pthread -o secant_client
@@ -1,2 +1,2 @@
-g++ -std=c++17 -O2 gui_secant_gtk.cpp libs/Tokenizer.cpp -o secant_gui_gtk $(pkg-config --cflags --libs gtk+-3.0)
+g++ -std=c++17 -O3 -march=native gui_secant_gtk.cpp libs/Tokenizer.cpp libs/CompiledExpression.cpp libs/EvalMemo.cpp libs/ExprGraph.cpp libs/ExpressionCache.cpp libs/Horner.cpp libs/Instrument.cpp libs/Interval.cpp libs/Jit.cpp libs/BatchSolver.cpp libs/RootIsolator.cpp libs/RootScanner.cpp libs/Solvers.cpp libs/ThreadPool.cpp libs/TraceFile.cpp libs/VecMath.cpp -pthread -o secant_gui_gtk $(pkg-config --cflags --libs gtk+-3.0)
 ./secant_gui_gtk
\ No newline at end of file
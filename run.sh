@@ -1,5 +1,16 @@
 # sudo g++ -std=c++11 -o secant_method "Secant Method Version 2.cpp" libs/Tokenizer.cpp -I.
 # sudo ./secant_method
 
-g++ -std=c++17 -O2 secant-method.cpp libs/Tokenizer.cpp -o secant_method
-./secant_method
\ No newline at end of file
+g++ -std=c++17 -O3 -march=native secant-method.cpp libs/Tokenizer.cpp libs/CompiledExpression.cpp libs/EvalMemo.cpp libs/ExprGraph.cpp libs/ExpressionCache.cpp libs/Horner.cpp libs/Instrument.cpp libs/Interval.cpp libs/Jit.cpp libs/BatchSolver.cpp libs/ParameterSweep.cpp libs/RootIsolator.cpp libs/RootScanner.cpp libs/Solvers.cpp libs/SolverServer.cpp libs/ThreadPool.cpp libs/TraceFile.cpp libs/VecMath.cpp -pthread -o secant_method
+./secant_method
+# Batch mode (one job per line, CSV or JSONL, stdin when no file is given):
+# ./secant_method --batch jobs.csv
+# Server mode (same lines over a Unix socket, see run-client.sh for the client):
+# ./secant_method --serve [socket]
+# Long runs: --trace writes the iterations to a binary file instead of the
+# table (--trace-keep n thins out long runs), --show-trace prints rows of it:
+# ./secant_method --trace run.trace --trace-keep 10000
+# ./secant_method --show-trace run.trace 0 100
+# Instrumented build: add -DSECANT_INSTRUMENT to the g++ line above, then
+# pass --stats to print per-phase counters and timings on exit:
+# ./secant_method --stats
@@ -0,0 +1,166 @@
+// Client for secant_method --serve: sends job lines to the server and prints
+// the answers as they arrive. The line formats are BatchSolver's (see
+// libs/BatchSolver.hpp); answers may come back in any order.
+//
+//   ./secant_client jobs.csv                        # one job per line
+//   ./secant_client -e "sin(x)-0.5,0,1,1e-12" -e "x^2-2,1.5"
+//   cat jobs.jsonl | ./secant_client                # stdin otherwise
+//   ./secant_client --socket /tmp/s.sock jobs.csv   # default: $SECANT_SOCKET
+//                                                   # or /tmp/secant-<uid>.sock
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "libs/SolverServer.hpp"
+
+using namespace std;
+
+/**
+ * @brief Connects to the server's socket.
+ * @param path Socket path.
+ * @return The connected descriptor, or -1 with errno set.
+ */
+int connect_to(const string& path)
+{
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof addr.sun_path)
+    {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memcpy(addr.sun_path, path.c_str(), path.size());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (sockaddr*)&addr, sizeof addr) != 0)
+    {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Writes all of data to fd.
+ * @return false if the server closed the connection first.
+ */
+bool send_all(int fd, const char* data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t n = write(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= size_t(n);
+    }
+    return true;
+}
+
+/**
+ * @brief Sends the requests, then closes the writing side so the server
+ *        knows there are no more. Runs next to the reading loop in main, so
+ *        the requests are pipelined however many there are.
+ * @param fd Connected socket.
+ * @param lines Requests given with -e; when empty, in is sent instead.
+ * @param in Request stream (a file or stdin).
+ */
+void send_requests(int fd, const vector<string>& lines, istream& in)
+{
+    if (!lines.empty())
+    {
+        string all;
+        for (const string& line : lines)
+            all += line + "\n";
+        send_all(fd, all.data(), all.size());
+    }
+    else
+    {
+        vector<char> buf(1 << 16);
+        while (in.read(buf.data(), buf.size()) || in.gcount() > 0)
+        {
+            if (!send_all(fd, buf.data(), size_t(in.gcount()))) break;
+        }
+    }
+    shutdown(fd, SHUT_WR);
+}
+
+int main(int argc, char** argv)
+{
+    string path = SolverServer::defaultPath();
+    string file = "-";
+    vector<string> lines;
+
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--socket" && i + 1 < argc)
+        {
+            path = argv[++i];
+        }
+        else if (arg == "-e" && i + 1 < argc)
+        {
+            lines.push_back(argv[++i]);
+        }
+        else if (arg == "-h" || arg == "--help")
+        {
+            cout << "Usage: secant_client [--socket path] [file | -e line ...]" << endl;
+            return 0;
+        }
+        else
+        {
+            file = arg;
+        }
+    }
+
+    // A server that hangs up early shows as a failed write, not a signal
+    signal(SIGPIPE, SIG_IGN);
+
+    ifstream input;
+    if (lines.empty() && file != "-")
+    {
+        input.open(file);
+        if (!input)
+        {
+            cerr << "Cannot open " << file << endl;
+            return 1;
+        }
+    }
+
+    int fd = connect_to(path);
+    if (fd < 0)
+    {
+        cerr << "Cannot connect to " << path << ": " << strerror(errno) << endl;
+        cerr << "Start the server with: ./secant_method --serve " << path << endl;
+        return 1;
+    }
+
+    thread writer(send_requests, fd, cref(lines), ref(lines.empty() && file != "-" ? input : cin));
+
+    // Answers are copied through as they arrive until the server closes
+    vector<char> buf(1 << 16);
+    for (;;)
+    {
+        ssize_t n = read(fd, buf.data(), buf.size());
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        cout.write(buf.data(), n);
+        cout.flush();
+    }
+
+    writer.join();
+    close(fd);
+    return 0;
+}
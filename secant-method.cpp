@@ -4,74 +4,647 @@
 #include <limits>  // For numeric_limits
 #include <string>
 #include "libs/Tokenizer.hpp"
+#include "libs/Solvers.hpp"
+#include "libs/RootScanner.hpp"
+#include "libs/RootIsolator.hpp"
+#include "libs/ParameterSweep.hpp"
+#include "libs/BatchSolver.hpp"
+#include "libs/SolverServer.hpp"
+#include "libs/TraceFile.hpp"
+#include "libs/Instrument.hpp"
+#include <fstream>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
 
 using namespace std;
 
-// Global parser and function expression string
-MathParser g_parser;
-std::string g_funcExpr;
+// Supported operations in the current parser: +, -, *, /, ^, parentheses,
+// sin(), cos(), tan(), exp(), log(). The variable is x; any other name is a
+// parameter whose value is asked for before solving.
 
 /**
- * @brief Calculates the value of the user-defined function f(x) provided as a string.
- *        Supported operations in the current parser: +, -, *, /, ^, parentheses, sin(), cos().
- *        Use variable name x (case-insensitive letters are treated as variable).
- * @param x The input value for the function.
- * @return The result of f(x).
+ * @brief Runs Newton-Raphson from x0 and prints its iteration table.
+ *        f'(x) is obtained together with f(x) from the compiled expression.
+ * @param f The compiled function.
+ * @param x0 The initial estimate.
+ * @param choice Stopping criterion (1 = fixed N iterations, 2 = EPS tolerance).
+ * @param max_iterations Iteration limit.
+ * @param epsilon Relative error tolerance (used when choice == 2).
+ * @return Process exit code.
  */
-double calculate_fx(double x)
+int run_newton(const CompiledExpression& f, double x0, int choice, int max_iterations, double epsilon)
 {
-    return g_parser.evaluate(g_funcExpr, x);
+    NewtonSolver solver(f, x0);
+    NewtonSolver::Step step{};
+    double error = numeric_limits<double>::max();
+    int iteration = 0;
+
+    const int W_ITER = 3;
+    const int W_VAL = 10;
+    const int W_ERR = 12;
+
+    cout << "\n--- Iteration Table (Newton-Raphson) ---" << endl;
+    cout << "|" << setw(W_ITER) << "N"
+        << " |" << setw(W_VAL) << "X"
+        << " |" << setw(W_VAL) << "F(X)"
+        << " |" << setw(W_VAL) << "F'(X)"
+        << " |" << setw(W_VAL) << "X_NEXT"
+        << " |" << setw(W_ERR) << "|(Xn-X)/Xn|" << " |" << endl;
+    cout << string(W_ITER + 2, '-') << "+" << string(W_VAL + 2, '-') << "+" << string(W_VAL + 2, '-')
+        << "+" << string(W_VAL + 2, '-') << "+" << string(W_VAL + 2, '-') << "+" << string(W_ERR + 2, '-') << "+" << endl;
+
+    while (iteration < max_iterations && (choice == 1 || error > epsilon))
+    {
+        if (!solver.step(step))
+        {
+            cout << "\n--- Newton-Raphson Method Failed ---" << endl;
+            cout << "Cannot continue because f'(x) == 0 in iteration " << iteration << "." << endl;
+            return 1;
+        }
+        error = step.err;
+
+        cout << "|" << setw(W_ITER) << step.n
+            << " |" << setw(W_VAL) << step.x
+            << " |" << setw(W_VAL) << step.fx
+            << " |" << setw(W_VAL) << step.dfx
+            << " |" << setw(W_VAL) << step.xNext
+            << " |" << setw(W_ERR) << error << " |" << endl;
+        iteration++;
+    }
+
+    cout << string(W_ITER + 2 + (W_VAL + 2) * 4 + W_ERR + 2 + 5, '-') << endl;
+
+    if (iteration > 0)
+    {
+        cout << "\nThe Root found after " << iteration << " iterations." << endl;
+        cout << "The approximate root is: " << solver.current() << endl;
+        cout << "Function evaluations: " << solver.evaluations() << endl;
+        cout << "Final relative approximate error is: " << error << "." << endl;
+    }
+    else
+    {
+        cout << "\nThe Convergence not achieved or no iterations were performed." << endl;
+    }
+    return 0;
+}
+
+/**
+ * @brief Where run_root_solver writes its iterations instead of printing
+ *        them (--trace file, --trace-keep n).
+ */
+struct TraceTarget
+{
+    string path; // empty: print the table
+    TraceOptions options;
+};
+
+// Column widths of the RootSolver iteration table.
+const int STEP_W_ITER = 3;
+const int STEP_W_VAL = 10;
+const int STEP_W_ERR = 12;
+
+/**
+ * @brief Prints the title and column headings of the RootSolver iteration table.
+ * @param title Shown in the title line, e.g. the method name.
+ */
+void print_step_header(const string& title)
+{
+    cout << "\n--- Iteration Table (" << title << ") ---" << endl;
+    cout << "|" << setw(STEP_W_ITER) << "N"
+        << " |" << setw(STEP_W_VAL) << "A"
+        << " |" << setw(STEP_W_VAL) << "F(A)"
+        << " |" << setw(STEP_W_VAL) << "B"
+        << " |" << setw(STEP_W_VAL) << "F(B)"
+        << " |" << setw(STEP_W_VAL) << "X"
+        << " |" << setw(STEP_W_VAL) << "F(X)"
+        << " |" << setw(STEP_W_ERR) << "|DX|" << " |" << endl;
+    cout << string(STEP_W_ITER + 2, '-');
+    for (int i = 0; i < 6; i++)
+        cout << "+" << string(STEP_W_VAL + 2, '-');
+    cout << "+" << string(STEP_W_ERR + 2, '-') << "+" << endl;
+}
+
+/**
+ * @brief Prints one row of the RootSolver iteration table.
+ * @param step The step, from the solver or from a trace file.
+ */
+void print_step_row(const RootSolver::Step& step)
+{
+    cout << "|" << setw(STEP_W_ITER) << step.n
+        << " |" << setw(STEP_W_VAL) << step.a
+        << " |" << setw(STEP_W_VAL) << step.fa
+        << " |" << setw(STEP_W_VAL) << step.b
+        << " |" << setw(STEP_W_VAL) << step.fb
+        << " |" << setw(STEP_W_VAL) << step.x
+        << " |" << setw(STEP_W_VAL) << step.fx
+        << " |" << setw(STEP_W_ERR) << step.dx << " |" << endl;
+}
+
+/**
+ * @brief Prints the line closing the RootSolver iteration table.
+ */
+void print_step_footer()
+{
+    cout << string(STEP_W_ITER + 2 + (STEP_W_VAL + 2) * 6 + STEP_W_ERR + 2 + 7, '-') << endl;
 }
 
 /**
- * @brief Computes the next approximation (x3) using the Secant Method formula.
- * The formula is: x3 = x2 - [f(x2) * (x2 - x1)] / [f(x2) - f(x1)]
- * @param x1 The previous approximation (x_i-1).
- * @param x2 The current approximation (x_i).
- * @return The next approximation (x_i+1 or x3).
+ * @brief Runs one of the two-point RootSolver methods from x1, x2 and prints
+ *        its iteration table. A and B are the bracket once f changes sign
+ *        between two iterates, and the two previous iterates until then.
+ * @param f The compiled function.
+ * @param method The RootSolver method.
+ * @param x1 The first initial estimate.
+ * @param x2 The second initial estimate.
+ * @param choice Stopping criterion (1 = fixed N iterations, 2 = EPS tolerance).
+ * @param max_iterations Iteration limit.
+ * @param epsilon Absolute and relative tolerance on x (used when choice == 2).
+ * @param trace Where to write the iterations instead of printing them (see
+ *        libs/TraceFile.hpp); empty prints the table.
+ * @return Process exit code.
  */
-double secant_method_next_x(double x1, double x2)
+int run_root_solver(const CompiledExpression& f, RootSolver::Method method, double x1, double x2,
+                    int choice, int max_iterations, double epsilon, const TraceTarget& trace)
 {
-    double fx1 = calculate_fx(x1);
-    double fx2 = calculate_fx(x2);
+    // With a fixed N only the iteration limit (or an exact root) stops the run
+    SolveOptions opts;
+    opts.maxIter = max_iterations;
+    opts.xAbsTol = (choice == 2) ? epsilon : 0.0;
+    opts.xRelTol = (choice == 2) ? epsilon : 0.0;
+
+    // The memo catches iterates that land exactly on an earlier point,
+    // e.g. the ends of a bracket that is kept for several steps
+    EvalMemo memo(f);
+    RootSolver solver(f, method, x1, x2, opts, &memo);
+    RootSolver::Step step{};
 
-    // Check for division by zero, returns Not A Number
-    if (fx2 == fx1)
+    if (!trace.path.empty())
+    {
+        // Long runs: the steps go to the file as binary rows, nothing is formatted
+        try {
+            TraceWriter writer(trace.path, trace.options);
+            while (solver.step(step))
+                writer.append(step);
+            writer.close();
+            cout << "\nWrote " << writer.rows() << " of " << writer.steps() << " iterations to " << trace.path
+                << " (print them with --show-trace " << trace.path << ")." << endl;
+        } catch (const std::exception& e) {
+            cerr << "Error: " << e.what() << endl;
+            return 1;
+        }
+    }
+    else
     {
-        return NAN;
+        print_step_header(RootSolver::methodName(method));
+        while (solver.step(step))
+            print_step_row(step);
+        print_step_footer();
+    }
+
+    // With a fixed N, reaching the limit is what was asked for
+    RootSolver::Status status = solver.status();
+    bool ok = status == RootSolver::CONVERGED || (choice == 1 && status == RootSolver::MAX_ITERATIONS);
+
+    cout << "\nStatus: " << (choice == 1 && status == RootSolver::MAX_ITERATIONS ? "done" : RootSolver::statusName(status))
+        << " after " << solver.iterations() << " iterations." << endl;
+    cout << "The approximate root is: " << solver.root() << endl;
+    cout << "F at the root is: " << scientific << solver.value() << fixed << endl;
+    cout << "Function evaluations: " << solver.evaluations() << endl;
+    cout << "Memo hits: " << memo.hits() << " of " << memo.lookups() << " lookups ("
+        << setprecision(1) << 100.0 * memo.hitRate() << "%)" << setprecision(6) << endl;
+
+    return ok ? 0 : 1;
+}
+
+/**
+ * @brief Prints rows of a trace file written by --trace as the iteration
+ *        table. Only the rows asked for are read from the file or formatted.
+ * @param path The trace file.
+ * @param first First row to print.
+ * @param count Number of rows to print; negative prints to the end.
+ * @return Process exit code.
+ */
+int show_trace(const string& path, long first, long count)
+{
+    TraceReader reader;
+    try {
+        reader.open(path);
+    } catch (const std::exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+
+    long rows = reader.rows();
+    first = max(0L, min(first, rows));
+    long last = (count < 0) ? rows : min(rows, first + count);
+
+    cout << fixed << setprecision(6);
+    print_step_header(path);
+    for (long i = first; i < last; i++)
+        print_step_row(reader.row(i));
+    print_step_footer();
+    cout << "Rows " << first << " to " << last << " of " << rows << "; "
+        << reader.steps() << " iterations were traced." << endl;
+    return 0;
+}
+
+/**
+ * @brief Solves f(x; p) = 0 for evenly spaced values of the parameter p and
+ *        prints one row per value. Each solve is warm-started from the roots
+ *        at the previous values; chunks of the range run on worker threads.
+ * @param f The compiled function, other parameters already set.
+ * @param param Index of the swept parameter in f.parameters().
+ * @param first First value of p.
+ * @param last Last value of p.
+ * @param count Number of values.
+ * @param x1 First initial estimate for the first solve.
+ * @param x2 Second initial estimate for the first solve.
+ * @param epsilon Absolute and relative tolerance on x.
+ * @return Process exit code.
+ */
+int run_sweep(const CompiledExpression& f, int param, double first, double last, int count,
+              double x1, double x2, double epsilon)
+{
+    ThreadPool pool;
+    ParameterSweep sweep(f, param, pool);
+    SweepOptions opts;
+    opts.solve.xAbsTol = epsilon;
+    opts.solve.xRelTol = epsilon;
+
+    auto start = chrono::steady_clock::now();
+    vector<ParameterSweep::Point> points = sweep.run(ParameterSweep::range(first, last, size_t(max(count, 1))), x1, x2, opts);
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    const int W_VAL = 14;
+    const int W_ITER = 6;
+    const string& name = f.parameters()[param];
+
+    cout << "\n--- Sweep of " << name << " over [" << first << ", " << last << "] ("
+        << pool.size() << " threads) ---" << endl;
+    cout << "|" << setw(W_VAL) << name
+        << " |" << setw(W_VAL) << "ROOT"
+        << " |" << setw(W_VAL) << "F(ROOT)"
+        << " |" << setw(W_ITER) << "ITER"
+        << " | STATUS" << endl;
+    cout << string(W_VAL + 1, '-') << "+" << string(W_VAL + 2, '-') << "+" << string(W_VAL + 2, '-')
+        << "+" << string(W_ITER + 2, '-') << "+" << string(12, '-') << endl;
+
+    long iterations = 0, evaluations = 0;
+    int converged = 0;
+    for (const ParameterSweep::Point& pt : points)
+    {
+        cout << "|" << setw(W_VAL) << pt.p
+            << " |" << setw(W_VAL) << pt.root
+            << " |" << setw(W_VAL) << scientific << pt.froot << fixed
+            << " |" << setw(W_ITER) << pt.iterations
+            << " | " << RootSolver::statusName(pt.status) << endl;
+        iterations += pt.iterations;
+        evaluations += pt.evaluations;
+        if (pt.status == RootSolver::CONVERGED) converged++;
+    }
+
+    cout << "\n" << converged << " of " << points.size() << " solves converged." << endl;
+    cout << "Iterations per solve: " << setprecision(2) << double(iterations) / points.size()
+        << ", function evaluations: " << evaluations << setprecision(6) << endl;
+    cout << "Time: " << setprecision(3) << ms << " ms" << setprecision(6) << endl;
+    return converged == int(points.size()) ? 0 : 1;
+}
+
+/**
+ * @brief Finds every root of f(x) on [a, b] and prints them.
+ *        With samples > 0, f is sampled on a grid; otherwise [a, b] is
+ *        bisected and every piece on which interval arithmetic shows f has
+ *        no zero is dropped. Either way, each bracket or near-zero minimum
+ *        left is refined on its own worker thread.
+ * @param f The compiled function.
+ * @param a Interval start.
+ * @param b Interval end.
+ * @param samples Number of grid points, or 0 for interval isolation.
+ * @return Process exit code.
+ */
+int run_all_roots(const CompiledExpression& f, double a, double b, int samples)
+{
+    ThreadPool pool;
+    vector<RootScanner::Root> roots;
+    RootIsolator::Isolation isolation;
+
+    if (samples > 0)
+    {
+        RootScanOptions opts;
+        opts.samples = samples;
+        roots = RootScanner(f, pool).findAll(a, b, opts);
+    }
+    else
+    {
+        RootIsolator isolator(f, pool);
+        isolation = isolator.isolate(a, b);
+        roots = isolator.solve(isolation);
+    }
+
+    const int W_ITER = 3;
+    const int W_VAL = 14;
+
+    cout << "\n--- Roots on [" << a << ", " << b << "] (" << pool.size() << " threads) ---" << endl;
+    cout << "|" << setw(W_ITER) << "N"
+        << " |" << setw(W_VAL) << "X"
+        << " |" << setw(W_VAL) << "F(X)"
+        << " |" << setw(W_VAL) << "EVALUATIONS" << " |" << endl;
+    cout << string(W_ITER + 2, '-') << "+" << string(W_VAL + 2, '-') << "+" << string(W_VAL + 2, '-')
+        << "+" << string(W_VAL + 2, '-') << "+" << endl;
+
+    for (size_t i = 0; i < roots.size(); i++)
+    {
+        cout << "|" << setw(W_ITER) << i
+            << " |" << setw(W_VAL) << roots[i].x
+            << " |" << setw(W_VAL) << scientific << roots[i].fx << fixed
+            << " |" << setw(W_VAL) << roots[i].evaluations << " |" << endl;
+    }
+
+    if (roots.empty())
+    {
+        cout << "\nNo roots found on the interval." << endl;
+    }
+    else
+    {
+        cout << "\n" << roots.size() << " root(s) found." << endl;
+    }
+    if (samples <= 0)
+    {
+        cout << "Interval search: " << isolation.boxes << " boxes, " << isolation.pruned
+            << " ruled out, " << isolation.brackets.size() << " bracket(s) left, "
+            << isolation.evaluations << " point evaluations." << endl;
+    }
+    return 0;
+}
+
+/**
+ * @brief Non-interactive mode: solves one job per input line and streams the
+ *        results to stdout (see libs/BatchSolver.hpp for the line formats).
+ * @param path Input file, or "-" for stdin.
+ * @return Process exit code.
+ */
+int run_batch(const string& path)
+{
+    ThreadPool pool;
+    BatchSolver batch(pool);
+
+    if (path == "-")
+    {
+        batch.run(cin, cout);
+        return 0;
+    }
+
+    ifstream file(path);
+    if (!file)
+    {
+        cerr << "Cannot open batch file: " << path << endl;
+        return 1;
+    }
+    batch.run(file, cout);
+    return 0;
+}
+
+// The server run_server is running, for the signal handler.
+static SolverServer* active_server = nullptr;
+
+extern "C" void stop_server(int)
+{
+    if (active_server) active_server->stop();
+}
+
+/**
+ * @brief Server mode: answers batch jobs (and f, f' evaluations) on a Unix
+ *        domain socket until SIGINT or SIGTERM, keeping the thread pool and
+ *        the parsed expressions between requests (see libs/SolverServer.hpp).
+ * @param path Socket path.
+ * @return Process exit code.
+ */
+int run_server(const string& path)
+{
+    ThreadPool pool;
+    BatchSolver batch(pool);
+    SolverServer server(batch, path);
+
+    active_server = &server;
+    std::signal(SIGINT, stop_server);
+    std::signal(SIGTERM, stop_server);
+
+    cerr << "Serving on " << path << " (" << pool.size() << " threads), Ctrl+C to stop." << endl;
+    try {
+        server.run();
+    } catch (const std::exception& e) {
+        active_server = nullptr;
+        cerr << "Error: " << e.what() << endl;
+        return 1;
     }
+    active_server = nullptr;
 
-    double x3 = x2 - (fx2 * (x2 - x1)) / (fx2 - fx1);
-    return x3;
+    cerr << "Served " << server.connections() << " connection(s), " << server.jobs() << " job(s); "
+        << batch.expressions().hits() << " cache hits, " << batch.expressions().misses() << " misses." << endl;
+    return 0;
 }
 
-int main()
+/**
+ * @brief Prints the instrumentation summary to stderr when main returns,
+ *        whichever path it returns through (--stats).
+ */
+struct StatsReport
+{
+    bool enabled = false;
+    Instrument::Totals start = Instrument::totals();
+
+    ~StatsReport()
+    {
+        if (enabled)
+            cerr << "\n" << Instrument::summary(start);
+    }
+};
+
+int main(int argc, char** argv)
 {
+    // secant_method [--stats] [--trace file [--trace-keep n]]
+    //               [--batch [file] | --serve [socket] | --show-trace file [first [count]]]
+    // (batch reads stdin when no file is given; see SolverServer::defaultPath for the socket)
+    StatsReport stats;
+    if (argc > 1 && string(argv[1]) == "--stats")
+    {
+        stats.enabled = true;
+        argc--;
+        argv++;
+    }
+
+    TraceTarget trace;
+    while (argc > 2 && (string(argv[1]) == "--trace" || string(argv[1]) == "--trace-keep"))
+    {
+        if (string(argv[1]) == "--trace")
+            trace.path = argv[2];
+        else
+            trace.options.keepAll = atol(argv[2]);
+        argc -= 2;
+        argv += 2;
+    }
+
+    if (argc > 2 && string(argv[1]) == "--show-trace")
+    {
+        return show_trace(argv[2], argc > 3 ? atol(argv[3]) : 0, argc > 4 ? atol(argv[4]) : -1);
+    }
+
+    if (argc > 1 && string(argv[1]) == "--batch")
+    {
+        std::ios::sync_with_stdio(false);
+        return run_batch(argc > 2 ? argv[2] : "-");
+    }
+    if (argc > 1 && string(argv[1]) == "--serve")
+    {
+        return run_server(argc > 2 ? argv[2] : SolverServer::defaultPath());
+    }
+
     // Set output precision and fixed notation
     cout << fixed << setprecision(6);
 
     // --- 1. User Inputs Function as a String ---
     cout << "### Secant Method Solver (f(x) as an expression) ###" << endl;
     cout << "Enter your function f(x) using 'x' as the variable" << endl;
-    cout << "Allowed: + - * / ^, parentheses, sin(), cos()" << endl;
+    cout << "Allowed: + - * / ^, parentheses, sin(), cos(), tan(), exp(), log()" << endl;
+    cout << "Other names are parameters, e.g. a*x^2 - b" << endl;
     cout << "Example: 3*x^2 - 2*x + 5 or sin(x) - 0.5" << endl;
     cout << "f(x) = ";
-    std::getline(cin >> std::ws, g_funcExpr);
+    string func_expr;
+    std::getline(cin >> std::ws, func_expr);
+
+    // Parse once; every iteration below only evaluates the compiled form.
+    // Parameters are bound to slots here, so evaluating looks up no names.
+    vector<string> params = MathParser::names(func_expr);
+    CompiledExpression func;
+    try {
+        func = MathParser().compile(func_expr, params);
+    } catch (const std::exception& e) {
+        cerr << "Error while parsing f(x): " << e.what() << endl;
+        return 1;
+    }
 
     // --- 2. User Inputs Initial Estimates and Stopping Criteria ---
     double x1, x2, epsilon = 0.0;
     int max_iterations = 0;
+    int method;
     int choice;
-    int iteration = 0;
+    RootSolver::Method root_method = RootSolver::SECANT;
 
-    cout << "\nYour function is: f(x) = " << g_funcExpr << endl;
+    cout << "\nYour function is: f(x) = " << func_expr << endl;
     cout << "---" << endl;
 
-    cout << "Enter initial estimate x1: ";
-    cin >> x1;
+    // Menu for the iteration method
+    cout << "Choose the method:" << endl;
+    cout << "1. Secant method (two initial estimates)." << endl;
+    cout << "2. Newton-Raphson method (one initial estimate, f'(x) is computed automatically)." << endl;
+    cout << "3. Find all roots in an interval [a, b]." << endl;
+    cout << "4. Brent's method (two initial estimates)." << endl;
+    cout << "5. Illinois method (two initial estimates)." << endl;
+    cout << "6. Anderson-Bjorck method (two initial estimates)." << endl;
+    cout << "7. Steffensen's method (two initial estimates)." << endl;
+    cout << "8. Sweep a parameter over a range (two initial estimates)." << endl;
+    cout << "Enter choice (1 to 8): ";
+    cin >> method;
+
+    // The swept parameter gets its values from the sweep, the others here
+    int swept = -1;
+    if (method == 8)
+    {
+        if (params.empty())
+        {
+            cerr << "f(x) has no parameters to sweep." << endl;
+            return 1;
+        }
+        string name = params[0];
+        if (params.size() > 1)
+        {
+            cout << "Parameter to sweep: ";
+            cin >> name;
+        }
+        swept = func.parameterIndex(name);
+        if (swept < 0)
+        {
+            cerr << "f(x) has no parameter " << name << "." << endl;
+            return 1;
+        }
+    }
+    for (size_t i = 0; i < params.size(); i++)
+    {
+        if (int(i) == swept) continue;
+        double value;
+        cout << "Enter the value of " << params[i] << ": ";
+        cin >> value;
+        func.setParameter(int(i), value);
+    }
+
+    if (method == 8)
+    {
+        double first, last;
+        int count;
+
+        cout << "Enter the first value of " << params[swept] << ": ";
+        cin >> first;
+
+        cout << "Enter the last value of " << params[swept] << ": ";
+        cin >> last;
+
+        cout << "Enter the number of values (e.g. 1000): ";
+        cin >> count;
+
+        cout << "Enter initial estimate x1: ";
+        cin >> x1;
+
+        cout << "Enter initial estimate x2: ";
+        cin >> x2;
+
+        cout << "Enter the error tolerance (EPS) : ";
+        cin >> epsilon;
+
+        return run_sweep(func, swept, first, last, count, x1, x2, epsilon);
+    }
+
+    if (method == 1 || (method >= 4 && method <= 7))
+    {
+        const RootSolver::Method two_point[] = {
+            RootSolver::BRENT, RootSolver::ILLINOIS, RootSolver::ANDERSON_BJORCK, RootSolver::STEFFENSEN
+        };
+        if (method >= 4)
+            root_method = two_point[method - 4];
 
-    cout << "Enter initial estimate x2: ";
-    cin >> x2;
+        cout << "Enter initial estimate x1: ";
+        cin >> x1;
+
+        cout << "Enter initial estimate x2: ";
+        cin >> x2;
+    }
+    else if (method == 2)
+    {
+        cout << "Enter initial estimate x0: ";
+        cin >> x1;
+    }
+    else if (method == 3)
+    {
+        double a, b;
+        int samples;
+
+        cout << "Enter interval start a: ";
+        cin >> a;
+
+        cout << "Enter interval end b: ";
+        cin >> b;
+
+        cout << "Enter number of grid points (e.g. 1000), or 0 to rule out" << endl;
+        cout << "subintervals with interval arithmetic instead: ";
+        cin >> samples;
+
+        return run_all_roots(func, a, b, samples);
+    }
+    else
+    {
+        cerr << "Invalid choice. Exiting program." << endl;
+        return 1;
+    }
 
     // Menu for Stopping Criterion
     cout << "\nChoose the stopping criterion:" << endl;
@@ -98,104 +671,11 @@ int main()
         return 1;
     }
 
-    // --- 3. Iterative Calculation and Table Output ---
-    double x3;
-    double error = numeric_limits<double>::max();
-    double fx3; // New variable to store f(x3)
-
-    // Set widths for alignment
-    const int W_ITER = 3;
-    const int W_VAL = 10;
-    const int W_ERR = 12;
-
-    cout << "\n--- Iteration Table ---" << endl;
-
-    // Table Header - Updated format
-    cout << "|" << setw(W_ITER) << "N"
-        << " |" << setw(W_VAL) << "X1"
-        << " |" << setw(W_VAL) << "F(X1)"
-        << " |" << setw(W_VAL) << "X2"
-        << " |" << setw(W_VAL) << "F(X2)"
-        << " |" << setw(W_VAL) << "X3"
-        << " |" << setw(W_VAL) << "F(X3)"
-        << " |" << setw(W_ERR) << "|(X3-X2)/X3|" << " |" << endl;
-
-    // Separator line
-    cout << string(W_ITER + 2, '-') << "+" << string(W_VAL + 2, '-') << "+" << string(W_VAL + 2, '-')
-        << "+" << string(W_VAL + 2, '-') << "+" << string(W_VAL + 2, '-') << "+" << string(W_VAL + 2, '-')
-        << "+" << string(W_VAL + 2, '-') << "+" << string(W_ERR + 2, '-') << "+" << endl;
-
-    while ((choice == 1 && iteration < max_iterations) || (choice == 2 && error > epsilon && iteration < max_iterations))
+    if (method == 2)
     {
-        double fx1, fx2;
-        try {
-            fx1 = calculate_fx(x1);
-            fx2 = calculate_fx(x2);
-        } catch (const std::exception& e) {
-            cerr << "Error while evaluating f(x): " << e.what() << endl;
-            return 1;
-        }
-
-        x3 = secant_method_next_x(x1, x2);
-
-        if (isnan(x3))
-        {
-            cout << "\n--- Secant Method Failed ---" << endl;
-            cout << "Cannot continue due to f(x2) == f(x1) in iteration " << iteration << "." << endl;
-            return 1;
-        }
-
-        // Calculate f(x3) and the relative approximate error
-        try {
-            fx3 = calculate_fx(x3);
-        } catch (const std::exception& e) {
-            cerr << "Error while evaluating f(x3): " << e.what() << endl;
-            return 1;
-        }
-        error = fabs((x3 - x2) / x3);
-
-        // Print the row
-        cout << "|" << setw(W_ITER) << iteration
-            << " |" << setw(W_VAL) << x1
-            << " |" << setw(W_VAL) << fx1
-            << " |" << setw(W_VAL) << x2
-            << " |" << setw(W_VAL) << fx2
-            << " |" << setw(W_VAL) << x3
-            << " |" << setw(W_VAL) << fx3 // Print f(x3)
-            << " |" << setw(W_ERR) << error << " |" << endl;
-
-        x1 = x2;
-        x2 = x3;
-        iteration++;
-
-        if (choice == 1 && iteration >= max_iterations)
-        {
-            break;
-        }
+        return run_newton(func, x1, choice, max_iterations, epsilon);
     }
 
-    // Total width calculation for final separator line
-    const int W_TOTAL = W_ITER + 2 + (W_VAL + 2) * 6 + W_ERR + 2 + 7;
-    cout << string(W_TOTAL, '-') << endl;
-
-    // --- 4. Final Result Output ---
-    if (iteration > 0)
-    {
-        cout << "\nThe Root found after " << iteration << " iterations." << endl;
-        cout << "The approximate root is: " << x3 << endl;
-
-        if (choice == 2)
-        {
-            cout << "Final relative approximate error is: " << error << " (Target EPS: " << epsilon << ")." << endl;
-        }
-        else
-        {
-            cout << "Final relative approximate error is: " << error << "." << endl << endl;
-        }
-    }
-    else
-    {
-        cout << "\nThe Convergence not achieved or no iterations were performed." << endl;
-    }
-    return 0;
+    // --- 3. Iterative Calculation and Table Output ---
+    return run_root_solver(func, root_method, x1, x2, choice, max_iterations, epsilon, trace);
 }
\ No newline at end of file